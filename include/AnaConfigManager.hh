@@ -2,10 +2,17 @@
 #define AnaConfigManager_h 1
 
 #include "ConfigReader.hh" 
+#include "AsymmetryEstimator.hh"
+#include "RunningStats.hh"
+#include "ShowerGrid.hh"
+#include "ResponseMatrix.hh"
 #include "G4TouchableHistory.hh"
+#include <ctime>
 
 class G4Step;
+struct CrystalSegment;
 class G4Run;
+class G4Track;
 
 class AnaConfigManager {
     public:
@@ -18,21 +25,64 @@ class AnaConfigManager {
     void SetUp(const G4Run* aRun, G4String outFileName);
     void BookNtuples();
     void BookHistos();
+    void BookStats();
+    void WriteStats();
     void Save() const;
 
     void FillBaseNtuple_summary(int tupleID,
-                                const std::vector<int> particleCounts,
-                                const std::vector<G4double> energySums) const;
-    void FillBaseNtuple_detailed(int tupleID, G4Step* step) const;
-    void FillCaloFrontTuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) const;
+                                const std::vector<G4double> particleCounts,
+                                const std::vector<G4double> energySums);
+    void FillBaseNtuple_detailed(int tupleID, G4Step* step);
+    void FillCaloFrontTuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step);
     void FillCaloFrontTuple_summary(int tupleID,
-                                    const std::vector<int> NP,
-                                    const std::vector<double> Esum) const;
-    void FillCaloCrystNtuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) const;
+                                    const std::vector<double> NP,
+                                    const std::vector<double> Esum);
+    void FillCaloCrystNtuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step);
+    void FillCaloCrystSegment(int tupleID, const CrystalSegment& segment);
+    void WriteHitBuffers(int eventID, bool keep = true);
+    void RegisterTrack(const G4Track* track);
+    void MarkTrack(int trackID);
+    void WriteTrackHistory(int eventID, bool keep = true);
+    bool ApplyTrigger(G4double edep, G4double ein);
+    // event abort facility, the first reason of an event is kept
+    void BeginOfEventAbort();
+    void RequestAbort(const std::string& reason);
+    void CountCrossing(int tupleID, G4double energy, bool energyLimit);
+    void CheckCrystalEdep(int crystNo, G4double edep);
+    void CheckCpuBudget();
+    void EndOfEventAbort(int eventID);
+    void EndOfRunAbort();
+    void EndOfRunTrigger();
+    void SetCrystalGeometry(G4double crystXY, G4double crystThick, G4double cellXY, const std::vector<G4ThreeVector>& positions, int cellDepth);
+    void FillCaloCluster(const std::vector<double>& edep, G4double ein, G4double einX, G4double einY);
+    void BookShowerGrid();
+    void FillShowerGrid(const G4VTouchable* history, G4Step* step);
+    void WriteShowerGrid(int eventID, bool keep = true);
     void FillCaloCrystNtuple_summary(int tupleID,
                                     const std::vector<double> Edep,
-                                    const std::vector<double> Tlength) const;
+                                    const std::vector<double> Tlength);
     void FillHistos(int histoID, G4Step* step) const;
+    void FillPairedTuple(int eventID, G4double edep, G4double ein);
+    bool AddAsymmetryEvent(G4double edep, G4double ein);
+    void AddResponseEvent(const std::vector<double>& edep, G4double ein);
+    void EndOfRunResponse();
+    void AddWeightedEvent(G4double edep, G4double ein);
+    void EndOfRunFigureOfMerit();
+    // stacking policy: tracks put on the stacks and killed per stack class, peak stack depth per event
+    void BeginOfEventStacking();
+    void CountStackedTrack(int stackClass, long depth);
+    void CountKilledTrack(int stackClass, G4double energy);
+    void EndOfEventStacking(int eventID);
+    void EndOfRunStacking();
+    void EndOfRunAsymmetry(int nEvents);
+    void SetFastPredictions(const std::vector<G4double>& asymmetries) { fFastPredictions = asymmetries; }
+    void AddRunMetadata(const std::string& key, const std::string& value);
+    // split productions (-j): output file suffix, first event ID and the job keys of the Metadata tree
+    void SetOutputSuffix(const std::string& suffix) { fOutputFileName += suffix; }
+    void SetEventIDOffset(int offset) { fEventIDOffset = offset; }
+    void AddJobMetadata(const std::string& key, const std::string& value);
+    void SetBlockEventCount(int nEvents) { fBlockEvents = nEvents; }
+    void EndOfRunSparse(int nEvents);
     void SetupMetadataTTree();
 
     //getter methods 
@@ -54,21 +104,262 @@ class AnaConfigManager {
     const int GetShowerDevStat() const{
         return fShowerDevStat;
     }
+    // the CaloCrystal tree holds steps (showerDev = 1) or track segments (showerDev = 3) instead of sums
+    bool HasCrystalHitTuple() const{
+        return fShowerDevStat == 1 || fShowerDevStat == 3;
+    }
 
     const G4double GetEinLim() const{
         return fEinLim;
     }
 
+    const int GetPairedStatus() const{
+        return fPairedStatus;
+    }
+
+    const G4double GetAsymPrecision() const{
+        return fAsymPrecision;
+    }
+
+    // the estimator also runs without target precision for the fastscan cross-check
+    const bool GetAsymEstimate() const{
+        return fAsymEstimate;
+    }
+
+    const int GetBlockSize() const{
+        return fBlockSize;
+    }
+
+    const int GetSparseStatus() const{
+        return fSparseStatus;
+    }
+
+    const std::string& GetDetailedLayout() const{
+        return fDetailedLayout;
+    }
+
+    const int GetAbortStatus() const{
+        return fAbortStatus;
+    }
+
+    const G4double GetAbortCrystEdep() const{
+        return fAbortCrystEdep;
+    }
+
+    const G4double GetCpuBudget() const{
+        return fAbortCpuBudget;
+    }
+
+    const int GetNCrystals() const{
+        return fNCrystals;
+    }
+
+    // levels between the crystal and its calorimeter cell, depends on the geometry detail level
+    const int GetCrystalCellDepth() const{
+        return fCrystalCellDepth;
+    }
+
+    const int GetClusterStatus() const{
+        return fClusterStatus;
+    }
+
+    const int GetResponseStatus() const{
+        return fResponseStatus;
+    }
+
+    const int GetWeightStatus() const{
+        return fWeightStatus;
+    }
+
+    const bool GetFomStatus() const{
+        return fFomStatus;
+    }
+
+    const int GetStackingStatus() const{
+        return fStackingStatus;
+    }
+
+    const std::vector<StackClassInfo>& GetStackClasses() const{
+        return fStackClasses;
+    }
+
+    // the SDs keep their sums also for the per hit output if a per event quantity needs them
+    bool NeedsCrystalSums() const{
+        return fShowerDevStat != 1 || fTriggerStatus || fAbortCrystEdep > 0 || fClusterStatus || fResponseStatus || fFomStatus
+            || fPairedStatus || fAsymEstimate;
+    }
+    bool NeedsFrontSums() const{
+        return fOutputMode != "detailed" || fTriggerStatus || fClusterStatus || fResponseStatus || fFomStatus || fPairedStatus
+            || fAsymEstimate;
+    }
+
+    const int GetTriggerStatus() const{
+        return fTriggerStatus;
+    }
+
+    const int GetTrackHistoryStatus() const{
+        return fTrackHistory;
+    }
+
+    const std::string& GetShowerWrite() const{
+        return fShowerWrite;
+    }
+
     private:
+    // writes one row of summary columns, or updates the running moments in stats mode
+    void AddSummaryRow(int tupleID, const std::vector<G4double>& row);
+    // per hit columns, written directly (row layout) or buffered until the end of the event (vector layout)
+    void BookHitVectors(int tupleID, const std::vector<BranchInfo>& branchesInfo);
+    void FillHitColumn(int tupleID, int column, G4double value);
+    void AddHitRow(int tupleID);
+
     // using the convention of putting an f in front of member variables 
     const ConfigReader& fConfig;
     const std::string fOutputMode;
     const G4double fEinLim;
-    const std::string fOutputFileName;
+    std::string fOutputFileName;
     const int fShowerDevStat;
     const std::vector<TreeInfo> fTreesInfo; // tree info is structure with name, title and id
     std::map<std::string, int> fNtupleNameToIdMap; // need this for defining sensitive volumes in the subdetector classes
     const std::vector<HistoInfo>fHistoInfo;
+    std::map<int, std::vector<std::string>> fColumnTypes; // column types per ntuple ID
+
+    // block mode: rows hold the sums of fBlockSize events, the last block of a run can be shorter
+    const int fBlockSize;
+    int fBlockEvents = 0;
+
+    // sparse summary: rows with only zeros are skipped, the others carry the EventID
+    const int fSparseStatus;
+    std::map<int, long> fSkippedRows; // per ntuple ID
+
+    // vector layout of the per hit ntuples: buffers per ntuple ID and column,
+    // bound to the vector columns of the analysis manager
+    const std::string fDetailedLayout;
+    std::map<int, std::vector<std::vector<float>>> fHitBufferF;
+    std::map<int, std::vector<std::vector<int>>> fHitBufferI;
+    std::map<int, int> fHitEventColumn; // index of the scalar EventID column
+
+    // event aborts: EinLimit (energy through a front detector), crystal Edep
+    // saturation, number of crossings of one detector and CPU time per event
+    G4double fAbortCrystEdep = 0.;
+    int fAbortMaxCrossings = 0;
+    G4double fAbortCpuBudget = 0.; // seconds
+    int fAbortStatus = 0;
+    int fAbortTupleID = -1;
+    std::string fAbortReason; // of the current event, empty if not aborted
+    std::clock_t fEventStartClock = 0;
+    std::map<int, int> fEventCrossings; // per ntuple ID
+    std::map<int, G4double> fEventEnergy; // per ntuple ID
+    std::map<int, G4double> fEventCrystEdep; // per crystal, the SD sums are not reset per event in SumRun/block
+    std::map<std::string, long> fAbortCounts;
+
+    // trigger: the hit rows of an event are buffered (row major, all columns)
+    // and only written if the event passes the trigger
+    const int fTriggerStatus;
+    G4double fTrigEdepMin = 0.;
+    int fTrigFrontHit = 0;
+    long fTrigEvents = 0;
+    long fTrigAccepted = 0;
+    std::map<int, std::vector<G4double>> fHitRowBuffer;
+
+    // track history: all tracks of the event are registered, the ones with hits
+    // and their ancestors are written to the TrackHistory tree at the end of the event
+    struct TrackRecord {
+        G4int parentID = 0;
+        G4int pdg = 0;
+        G4ThreeVector vertex;
+        G4double Ekin = 0.;
+        std::string process;
+        bool registered = false;
+        bool write = false;
+    };
+    const int fTrackHistory;
+    int fTrackHistoryTupleID = -1;
+    std::vector<TrackRecord> fTrackRecords; // index is the TrackID
+
+    // showerDev = 2: voxel grid per crystal written per event or per run,
+    // plus longitudinal and radial profiles of the deposited energy
+    G4double fCrystXY = 0.;
+    G4double fCrystThick = 0.;
+    G4double fCellXY = 0.; // distance between neighbouring crystals
+    std::vector<G4ThreeVector> fCrystalPos; // in the calorimeter mother volume, index is the copy number
+    int fCrystalCellDepth = 3; // crystal -> air gap -> wrapping -> cell
+
+    // CaloCluster: per event reduction of the crystal sums and the front detector hits
+    const int fClusterStatus;
+    int fClusterTupleID = -1;
+
+    // number of crystals of the N x M matrix, size of the per crystal SD sums
+    const int fNCrystals;
+    const std::string fShowerWrite;
+    ShowerGrid fShowerGrid;
+    int fShowerTupleID = -1;
+    int fShowerLongID = -1;
+    int fShowerRadialID = -1;
+
+    // stats mode: running moments and covariance ntuple per detector tuple ID
+    std::map<int, RunningStats> fStats;
+    std::map<int, std::vector<std::string>> fStatsColumns;
+    std::map<int, int> fStatsCovTupleID;
+
+    // polarization state of the current run, runs alternate in asymmetry mode
+    int fPolState = 0;
+
+    // paired runs: the first run stores Edep and Ein per event, the second
+    // one writes the per event differences to the PairedDiff ntuple
+    const int fPairedStatus;
+    int fPairedTupleID = -1;
+    std::vector<std::pair<G4double, G4double>> fPairedReference;
+
+    // online asymmetry estimate, a run is stopped once the target precision is reached
+    const G4double fAsymPrecision;
+    const int fAsymCheckEvery;
+    const int fAsymMaxEvents;
+    const bool fAsymUseFront;
+    const bool fAsymEstimate;
+    AsymmetryEstimator fAsymEstimator;
+    std::string fAsymStopReason;
+
+    // response runs: moments and distributions of Ein, Edep and the crystal sums per energy
+    // and polarization sign, written to response_<fileName>.txt after every run
+    const int fResponseStatus;
+    const std::vector<double> fResponseEnergies;
+    int fResponseNBins = 100;
+    G4double fResponseHistMax = 0.; // MeV
+    RunningStats fResponseStats;
+    std::vector<double> fResponseHist; // counts, row major nColumns x nBins
+    ResponseMatrix fResponse;
+    int fRunID = 0;
+
+    // fastscan cross-check: model asymmetry of every pair of runs
+    std::vector<G4double> fFastPredictions;
+
+    // biased runs: the detailed rows get the track weight, sums and histograms are weighted
+    const int fWeightStatus;
+    // per event weighted Edep and Ein for the variance and the figure of merit of the run,
+    // only with per event sums (not SumRun or block)
+    bool fFomStatus = false;
+    RunningStats fFomStats;
+    std::clock_t fRunStartClock = 0;
+
+    // stacking policy: per event and per run counts of the StackingAction, the
+    // memory is estimated from the peak depth and the size of a stacked track
+    const int fStackingStatus;
+    const std::vector<StackClassInfo> fStackClasses;
+    int fStackTupleID = -1;
+    long fStackPeakDepth = 0;
+    long fStackRunPeakDepth = 0;
+    std::vector<long> fStackedTracks;   // per stack class
+    std::vector<long> fKilledTracks;
+    std::vector<G4double> fKilledEnergy;
+    std::vector<long> fRunKilledTracks;
+    std::vector<G4double> fRunKilledEnergy;
+
+    // results of the current run which are written to the Metadata tree
+    std::vector<std::pair<std::string, std::string>> fRunMetadata;
+    // worker of a split production, written to the Metadata tree of every run
+    std::vector<std::pair<std::string, std::string>> fJobMetadata;
+    int fEventIDOffset = 0;
 }; 
 
 
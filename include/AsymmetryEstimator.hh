@@ -0,0 +1,34 @@
+// AsymmetryEstimator.hh
+#ifndef AsymmetryEstimator_h
+#define AsymmetryEstimator_h 1
+
+#include "RunningStats.hh"
+
+#include <array>
+#include <vector>
+
+// Keeps the running moments (RunningStats) of the crystal energy deposition (x)
+// and the energy in front of the calorimeter (y) for both polarization states. The
+// transmission of a state is the ratio R = sum(x)/sum(y), the asymmetry is
+// A = (R0-R1)/(R0+R1). Errors are propagated to first order (delta method).
+class AsymmetryEstimator {
+public:
+    AsymmetryEstimator();
+    ~AsymmetryEstimator();
+
+    void Reset();
+    void ResetState(int state);
+    void Add(int state, double x, double y);
+
+    long GetNEvents(int state) const { return fStats[state].GetN(); }
+    // transmission ratio of one state and its standard error
+    double GetRatio(int state, double& error) const;
+    // transmission asymmetry of the two states and its standard error
+    double GetAsymmetry(double& error) const;
+
+private:
+    std::array<RunningStats, 2> fStats; // columns x and y per state
+    std::vector<double> fRow;
+};
+
+#endif // AsymmetryEstimator_h
@@ -9,17 +9,21 @@
 
 class BaseSensitiveDetector : public G4VSensitiveDetector {
 public:
-    BaseSensitiveDetector(const G4String& name, const std::string& layerIdentifier, int tupleID, AnaConfigManager& anaConfigManager);
+    // boundaryOnly: only the step entering the volume counts, as needed for the thin scoring planes,
+    // normal: particles are counted if they move along this direction
+    BaseSensitiveDetector(const G4String& name, const std::string& layerIdentifier, int tupleID, AnaConfigManager& anaConfigManager,
+                          G4bool boundaryOnly = false, const G4ThreeVector& normal = G4ThreeVector(0., 0., 1.));
     virtual ~BaseSensitiveDetector();
 
     virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory* history) override;
 
     // Getter methods
     G4double GetEnergySum() const {return fEnergySum;}
-    G4int GetTotalCount() const {return fNtot;}
-    G4int GetGammaCount() const {return fNgamma;}
+    // the counts are weighted like the energy sums, 1 per particle without biasing
+    G4double GetTotalCount() const {return fNtot;}
+    G4double GetGammaCount() const {return fNgamma;}
     G4double GetGammaEnergySum() const {return fEgammaSum;}
-    G4int GetElectronCount() const {return fNe;}
+    G4double GetElectronCount() const {return fNe;}
     G4double GetElectronEnergySum() const {return fEeSum;}
     int GetTupleID() const {return fTupleID;}
 
@@ -29,10 +33,10 @@ public:
 private:
     // Member variables initialization
     G4double fEnergySum = 0;
-    G4int fNtot = 0;
-    G4int fNgamma = 0;
+    G4double fNtot = 0;
+    G4double fNgamma = 0;
     G4double fEgammaSum = 0;
-    G4int fNe = 0;
+    G4double fNe = 0;
     G4double fEeSum = 0;
 
     // Additional private members
@@ -40,6 +44,8 @@ private:
     int fTupleID;
     AnaConfigManager& fAnaConfigManager;
     const std::string fOutputMode;
+    const G4bool fBoundaryOnly;
+    const G4ThreeVector fNormal;
     
 };
 
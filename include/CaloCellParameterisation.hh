@@ -0,0 +1,28 @@
+// CaloCellParameterisation.hh
+#ifndef CaloCellParameterisation_h
+#define CaloCellParameterisation_h 1
+
+#include "G4VPVParameterisation.hh"
+#include "G4ThreeVector.hh"
+
+class G4VPhysicalVolume;
+
+// Places the calorimeter cells of an nX x nY matrix in the calorimeter mother
+// volume. Copy number = row*nX + column, row 0 at +y and column 0 at -x.
+class CaloCellParameterisation : public G4VPVParameterisation {
+public:
+    CaloCellParameterisation(G4int nX, G4int nY, G4double pitch, G4double zPos);
+    virtual ~CaloCellParameterisation();
+
+    virtual void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const override;
+
+    G4ThreeVector GetCellPosition(G4int copyNo) const;
+
+private:
+    G4int fNX;
+    G4int fNY;
+    G4double fPitch;
+    G4double fZPos;
+};
+
+#endif // CaloCellParameterisation_h
@@ -4,6 +4,22 @@
 #include "G4VSensitiveDetector.hh"
 #include <string>
 #include "AnaConfigManager.hh" 
+#include "G4ThreeVector.hh"
+
+// showerDev = 3: consecutive steps of one track in one crystal merged into one record
+struct CrystalSegment {
+    G4int trackID = -1;
+    G4int parentID = 0;
+    G4int pdg = 0;
+    G4int crystNo = -1;
+    G4double E = 0.; // total energy at the entry point
+    G4ThreeVector entry;
+    G4ThreeVector exit;
+    G4double Edep = 0.;
+    G4double Edep_ct = 0.; // deposited above the Cherenkov threshold
+    G4int nSteps = 0;
+    G4double weight = 1.; // track weight of all steps, Edep is not weighted as in the per step rows
+};
 
 class CaloCrystalSD: public G4VSensitiveDetector {
 public:
@@ -19,6 +35,8 @@ public:
 
     // method to reset the member variables 
     void Reset();
+    // writes the open track segment, called at track exit and at the end of the event
+    void FlushSegment();
 
 private:
     // Member variables initialization
@@ -30,6 +48,7 @@ private:
     int fTupleID;
     AnaConfigManager& fAnaConfigManager;
     const int fShowerDevStat;
+    CrystalSegment fSegment;
     
 };
 
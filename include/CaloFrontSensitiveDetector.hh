@@ -14,7 +14,11 @@ public:
 
     // Getter methods
     std::vector<double> GetEnergySum() const {return fEnergySum;}
-    std::vector<int> GetTotalCount() const {return fNtot;}
+    // weighted like the energy sums
+    std::vector<double> GetTotalCount() const {return fNtot;}
+    // energy weighted x and y sums in the calorimeter frame
+    G4double GetEnergyX() const {return fEnergyX;}
+    G4double GetEnergyY() const {return fEnergyY;}
     int GetTupleID() const {return fTupleID;}
 
     // method to reset the member variables 
@@ -23,9 +27,9 @@ public:
 private:
     // Member variables initialization
     std::vector<double> fEnergySum;
-    std::vector<int> fNtot;
-    G4double fEinLim;
-    G4double fEin_tot;
+    std::vector<double> fNtot;
+    G4double fEnergyX = 0.;
+    G4double fEnergyY = 0.;
     G4double ffrontZPos; // posisiton of the front sensitive detector 
     // Additional private members
     const std::string fLayerIdentifier;
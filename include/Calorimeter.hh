@@ -24,9 +24,11 @@ private:
     AnaConfigManager& fAnaConfigManager;
     G4int fCaloState;
     G4String fType;
-    G4int fNcrystals;
+    G4int fNcrystX; // crystals in x
+    G4int fNcrystY; // crystals in y
     G4String fCaloMat;
     G4String fWorldMaterial;
+    G4String fDetailLevel; // full, reduced or minimal
     G4LogicalVolume* fLogicCrystal;
     G4LogicalVolume* fLogicFrontDet;
     G4LogicalVolume* fLogicBackDet;
@@ -0,0 +1,43 @@
+// ComptonBiasingOperator.hh
+#ifndef ComptonBiasingOperator_h
+#define ComptonBiasingOperator_h 1
+
+#include "G4VBiasingOperator.hh"
+
+#include <map>
+
+class G4BOptnChangeCrossSection;
+class G4ParticleDefinition;
+
+// [Biasing] coreBiasing = scale: the cross section of the wrapped gamma processes
+// (Compton, see PhysicsList) is multiplied by xsScale in the volumes the operator
+// is attached to, i.e. the iron core. The analog cross section is the one of the
+// wrapped process, so the spin dependence of polarised Compton scattering is kept;
+// the track weight is corrected by G4BOptnChangeCrossSection.
+class ComptonBiasingOperator : public G4VBiasingOperator {
+public:
+    ComptonBiasingOperator(G4double xsScale);
+    ~ComptonBiasingOperator() override;
+
+    void StartRun() override;
+
+private:
+    G4VBiasingOperation* ProposeOccurenceBiasingOperation(const G4Track* track,
+                                                          const G4BiasingProcessInterface* callingProcess) override;
+    G4VBiasingOperation* ProposeFinalStateBiasingOperation(const G4Track*, const G4BiasingProcessInterface*) override {
+        return nullptr;
+    }
+    G4VBiasingOperation* ProposeNonPhysicsBiasingOperation(const G4Track*, const G4BiasingProcessInterface*) override {
+        return nullptr;
+    }
+    // the operation has to know whether its interaction took place to resample
+    void OperationApplied(const G4BiasingProcessInterface* callingProcess, G4BiasingAppliedCase biasingCase,
+                          G4VBiasingOperation* occurenceOperationApplied, G4double weightForOccurenceInteraction,
+                          G4VBiasingOperation* finalStateOperationApplied, const G4VParticleChange* particleChangeProduced) override;
+
+    G4double fXSScale;
+    const G4ParticleDefinition* fGamma;
+    std::map<const G4BiasingProcessInterface*, G4BOptnChangeCrossSection*> fOperations;
+};
+
+#endif
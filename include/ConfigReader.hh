@@ -9,7 +9,7 @@
 //structure that holds info about the branches 
 struct BranchInfo {
     std::string name;
-    std::string type; // "D" for double, "I" for integer, etc.
+    std::string type; // "D" for double, "I" for integer, "S" for string
 };
 
 // Structure to hold information about each TTree
@@ -22,6 +22,16 @@ struct TreeInfo {
         : name(n), title(t), id(i) {}
 };
 
+// scoring plane in the parallel world, one line in [ScoringPlanes]: name = z sizeX sizeY [xRot yRot]
+struct ScoringPlaneInfo {
+    std::string name; // also the name of the tree and of the sensitive detector
+    double z;         // centre in the world, mm
+    double sizeX;     // mm
+    double sizeY;     // mm
+    double xRot;      // deg
+    double yRot;      // deg
+};
+
 struct HistoInfo{
     std::string title; 
     int id;
@@ -29,6 +39,13 @@ struct HistoInfo{
     : title(t), id(i) {}
 };
 
+// stack class of the stacking policy: optical photons, particles below and above [Stacking] lowEnergy
+struct StackClassInfo {
+    std::string name;
+    std::string policy; // "process" (urgent stack), "defer" (waiting stack) or "kill"
+    long cap;           // depth of the stack above which new tracks of the class are killed, 0: no cap
+};
+
 class ConfigReader {
 public:
     ConfigReader(const std::string& configFile);
@@ -42,9 +59,36 @@ public:
     const std::map<std::string, std::map<std::string, std::string>>& GetConfigValues() const;
     std::string ReadOutputFileName() const;
     int ReadShowerDevStat() const;
+    int ReadPairedStatus() const;
+    G4double ReadAsymPrecision() const;
+    int ReadBlockSize() const;
+    int ReadNBunch() const;
+    int ReadBunchChunks() const;
+    int ReadStreamSize() const;
+    int ReadSparseStatus() const;
+    std::string ReadDetailedLayout() const;
+    int ReadTrackHistoryStatus() const;
+    int ReadTriggerStatus() const;
+    int ReadClusterStatus() const;
+    int ReadNCrystalsX() const;
+    int ReadNCrystalsY() const;
+    std::string ReadDetailLevel() const;
+    std::vector<ScoringPlaneInfo> ReadScoringPlanes() const;
+    int ReadResponseStatus() const;
+    std::vector<double> ReadResponseEnergies() const;
+    int ReadCrossCheckEvents() const;
+    std::string ReadCoreBiasing() const;
+    int ReadImportanceStatus() const;
+    std::vector<std::string> ReadImportanceParticles() const;
+    int ReadWeightStatus() const;
+    int ReadStackingStatus() const;
+    std::vector<StackClassInfo> ReadStackClasses() const;
+    int ReadIntOrDefault(const std::string& section, const std::string& key, int defaultValue) const;
     //methods for reading tree and branch configurations 
     std::vector<TreeInfo> ReadTreesInfo() const;
     std::vector<BranchInfo> GetBranchesInfo(const std::string& treeName) const;
+    std::vector<BranchInfo> GetSummaryBranchesInfo(const std::string& treeName) const;
+    std::vector<BranchInfo> GetStatsBranchesInfo() const;
     std::vector<HistoInfo> ReadHistoInfo() const;
 
 private:
@@ -17,9 +17,15 @@ public:
     virtual void EndOfEventAction(const G4Event*) override;
 
 private:
+    // sum of the crystal energy deposition and the energy in front of the calorimeter
+    void GetCaloObservables(G4double& edep, G4double& ein) const;
+
     AnaConfigManager& fAnaConfigManager;
     const std::string fOutputMode;
     const std::vector<TreeInfo> fTreesInfo;
+    const int fPairedStatus;
+    const bool fAsymEstimate;
+    const int fBlockSize;
     
 };
 
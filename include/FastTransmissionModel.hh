@@ -0,0 +1,74 @@
+// FastTransmissionModel.hh
+#ifndef FastTransmissionModel_h
+#define FastTransmissionModel_h 1
+
+#include "ConfigReader.hh"
+#include "globals.hh"
+
+#include <string>
+#include <vector>
+
+class G4Material;
+
+// Semi-analytic photon transmission through the magnetised iron core for
+// [Run] type = fastscan. The attenuation is taken from the gamma processes of
+// the physics list (G4EmCalculator), the spin dependent part from the
+// polarised Compton cross section (Tolhoek) with the electron density of the
+// core material. For every point of the [FastScan] grid the transmission of
+// both polarization signs, the number and energy weighted asymmetries and the
+// transmitted spectrum of the input spectrum are computed. Needs the physics
+// tables, i.e. /run/beamOn 0 before RunScan.
+class FastTransmissionModel {
+public:
+    struct ScanPoint {
+        G4double coreLength; // mm
+        G4double coreRad;    // mm
+        G4double polDeg;     // electron polarization of the core
+        G4double Bz;         // tesla, only used for the cross-check runs
+        G4double acceptance = 0; // fraction of the beam hitting the core
+        G4double tPlus = 0;  // transmitted fraction of the photons
+        G4double tMinus = 0;
+        G4double asymN = 0;  // number weighted asymmetry
+        G4double asymE = 0;  // energy weighted asymmetry
+    };
+
+    FastTransmissionModel(const ConfigReader& config);
+    ~FastTransmissionModel();
+
+    // computes all scan points and writes fastscan_<fileName>.txt and fastscan_<fileName>_spectra.txt
+    void RunScan();
+
+    const std::vector<ScanPoint>& GetPoints() const { return fPoints; }
+    // points for the full simulation: only polDeg and Bz can change without a new geometry
+    std::vector<ScanPoint> GetCrossCheckPoints() const;
+
+    // polarization dependent part of the Compton cross section per electron
+    static G4double PolarizedComptonCrossSection(G4double energy);
+
+private:
+    std::vector<G4double> ReadList(const std::string& key, G4double defaultValue) const;
+    void ReadSpectrum();
+    void ComputeCrossSections();
+    G4double GetAcceptance(G4double coreRad) const;
+
+    const ConfigReader& fConfig;
+    std::string fFileName;
+    G4Material* fCoreMaterial;
+    G4double fPhotonPol;
+    int fNSub;
+
+    // input spectrum, evaluated at the sub bin centres
+    std::vector<G4double> fEnergies;  // MeV
+    std::vector<G4double> fWeights;   // photons
+    std::vector<int> fBinIndex;       // spectrum bin of every sub bin energy
+    std::vector<G4double> fBinEnergies; // upper edges of the spectrum bins, MeV
+    std::vector<G4double> fBinWeights;
+
+    // per energy: total attenuation coefficient and polarised Compton part per unit polarization
+    std::vector<G4double> fMu;        // 1/mm
+    std::vector<G4double> fMuPol;     // 1/mm
+
+    std::vector<ScanPoint> fPoints;
+};
+
+#endif
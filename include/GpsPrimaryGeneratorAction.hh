@@ -48,16 +48,41 @@ namespace leap
 class GpsPrimaryGeneratorAction: public G4VUserPrimaryGeneratorAction
 {
   public:
-    GpsPrimaryGeneratorAction();
+    GpsPrimaryGeneratorAction(const ConfigReader& config);
     ~GpsPrimaryGeneratorAction() override;
 
     // methods
     void GeneratePrimaries(G4Event*) override;
+    // streaming: adds the next group of at most fStreamSize primaries of the
+    // current event to the given event, returns their number (0 when done)
+    G4int GenerateStreamChunk(G4Event* event);
+    G4int GetStreamSize() const { return fStreamSize; }
+    // split productions: the events of this process continue the event IDs of the previous ones
+    void SetEventIDOffset(G4int offset) { fEventIDOffset = offset; }
 
   private:
     // data members
     G4GeneralParticleSource*  fGeneralParticleSource = nullptr;
 
+    // paired runs: every event gets its own random stream derived from
+    // the event ID, so event i of both polarization runs is seeded identically
+    G4int fPairedStatus = 0;
+    long fSeed1 = 0;
+    long fSeed2 = 0;
+
+    // a bunch of fNBunch primaries split into fNChunks consecutive events,
+    // the sums of the chunks are added up in block mode
+    G4int fNBunch = 1;
+    G4int fNChunks = 1;
+
+    // streaming: only fStreamSize primaries are generated with the event, the
+    // rest is injected by the StackingAction whenever the urgent stack is empty
+    G4int fStreamSize = 0;
+    G4int fRemaining = 0;
+
+    // added to the event ID before anything else uses it
+    G4int fEventIDOffset = 0;
+
 };
 
 }
@@ -0,0 +1,30 @@
+// ImportanceParallelWorld.hh
+#ifndef ImportanceParallelWorld_h
+#define ImportanceParallelWorld_h 1
+
+#include "G4VUserParallelWorld.hh"
+#include "ConfigReader.hh"
+
+// [Importance]: slabs along the beam axis from zMin to zMax in a parallel world,
+// the importance grows by ratio from one slab to the next, the last slab reaches
+// to the end of the world and contains the calorimeter. The rest of the world has
+// importance 1. Particles entering a more important slab are split, the ones going
+// back are played Russian roulette (G4ImportanceBiasing, see PhysicsList).
+class ImportanceParallelWorld : public G4VUserParallelWorld {
+public:
+    ImportanceParallelWorld(const ConfigReader& config);
+    ~ImportanceParallelWorld() override;
+
+    // builds the slabs and fills the importance store of this world
+    void Construct() override;
+
+    static const G4String& GetWorldName();
+
+private:
+    G4double fZMin;  // mm, world frame
+    G4double fZMax;
+    G4int fNCells;
+    G4double fRatio; // importance ratio of neighbouring slabs
+};
+
+#endif
@@ -2,7 +2,9 @@
 #define MACROGENERATOR_HH
 
 #include "ConfigReader.hh"
+#include "FastTransmissionModel.hh"
 #include <string>
+#include <vector>
 
 class MacroGenerator {
 public:
@@ -12,6 +14,16 @@ public:
 
     // Static function to generate macro based on config
     static void generateMacro(const ConfigReader& config, const std::string& tempMacroFilename );
+    // runs of the fastscan cross-check points
+    static void generateCrossCheckMacro(const ConfigReader& config, const std::vector<FastTransmissionModel::ScanPoint>& points, const std::string& tempMacroFilename);
+    // -j N: splits the macro into <macro>_setup.mac (everything before the first run plus
+    // /run/beamOn 0 to build the physics tables) and <macro>_w<i>.mac with the share of the
+    // events of worker i in every run. nWorkers is reduced if there are fewer events (or blocks),
+    // firstEvents gets the first event ID of every worker, eventsPerJob the number of events per
+    // run rounded up to whole blocks and bunches (the event IDs of one job of a split production).
+    // Returns the number of runs. The seeds of the workers are set by leap_sims
+    static int generateWorkerMacros(const ConfigReader& config, const std::string& tempMacroFilename, int& nWorkers,
+                                    std::vector<long>& firstEvents, long& eventsPerJob);
 };
 
 
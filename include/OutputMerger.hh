@@ -0,0 +1,76 @@
+// OutputMerger.hh
+#ifndef OutputMerger_h
+#define OutputMerger_h 1
+
+#include "ConfigReader.hh"
+#include "globals.hh"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Merges run<N>_<fileName>.root files of the same configuration, e.g. of a
+// batch production or of the workers of leap_sims -j. The columns of the
+// detector trees follow from ConfigReader::GetBranchesInfo as in
+// AnaConfigManager::BookNtuples: SumRun rows are summed row by row, the rows
+// of all other output modes and the per hit trees are concatenated (streamed
+// row by row, also the vector layout) and the E_tot_spec and Beam Profile histograms are added.
+// The Metadata trees must agree apart from the seeds, the file name and the
+// Result/Job keys, which are kept per input file. The other trees (clusters,
+// aborts, track history, ...) and stats outputs are not merged.
+class OutputMerger {
+public:
+    OutputMerger(const ConfigReader& config);
+    ~OutputMerger();
+
+    // merges the input files into outFile (without .root), false on an error or different configurations
+    bool Merge(const std::vector<std::string>& inFiles, const std::string& outFile);
+    void SetCheckConfig(bool check) { fCheckConfig = check; }
+
+    // merges every group (output file -> input files) in a process of its own,
+    // at most nProcesses at the same time. The files of one group are read one
+    // after the other, so a single output is not merged faster with nProcesses
+    static bool MergeGroups(const ConfigReader& config, const std::map<std::string, std::vector<std::string>>& groups,
+                            int nProcesses, bool checkConfig);
+
+private:
+    // column of a detector tree, vector columns hold the hits of one event (vector layout)
+    struct MergeColumn {
+        std::string name;
+        std::string type; // "D", "I" or "S"
+        bool isVector;
+    };
+    // buffers the input columns are bound to, the vector columns are also bound to the output
+    struct TreeBuffers {
+        std::vector<MergeColumn> columns;
+        std::vector<G4double> valuesD;
+        std::vector<G4int> valuesI;
+        std::vector<G4String> valuesS;
+        std::vector<std::vector<G4float>> vectorsF;
+        std::vector<std::vector<G4int>> vectorsI;
+        std::vector<std::vector<G4double>> rowSums; // SumRun: per row, all columns
+    };
+    using Metadata = std::vector<std::pair<std::string, std::string>>;
+
+    bool IsHitTuple(const std::string& treeName) const;
+    std::vector<MergeColumn> GetColumns(const std::string& treeName) const;
+    bool ReadMetadata(const std::string& inFile, Metadata& metadata) const;
+    bool IsConfigKey(const std::string& key) const;
+    bool CheckMetadata(const std::vector<std::string>& inFiles, const std::vector<Metadata>& metadata) const;
+    void BookTree(const TreeInfo& treeInfo);
+    long MergeTree(const TreeInfo& treeInfo, const std::string& inFile);
+    void WriteSumRows(const TreeInfo& treeInfo);
+    void MergeHistos(const std::string& inFile);
+
+    const ConfigReader& fConfig;
+    const std::string fOutputMode;
+    const std::vector<TreeInfo> fTreesInfo;
+    const std::vector<HistoInfo> fHistoInfo;
+    bool fCheckConfig = true;
+    std::map<int, TreeBuffers> fBuffers; // per tree ID
+    std::vector<int> fH1IDs; // output histograms per HistoInfo
+    std::vector<int> fH2IDs;
+};
+
+#endif
@@ -43,7 +43,10 @@
 #include "ConfigReader.hh"
 #include "globals.hh"
 
+#include <vector>
+
 class G4VPhysicsConstructor;
+class G4GeometrySampler;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -69,6 +72,12 @@ private:
   // pointers to self defined physics lists
   G4VPhysicsConstructor*  fEmPhysicsList;
   G4VPhysicsConstructor*  fOptPhysicsList;
+  G4VPhysicsConstructor*  fScoringWorldPhysics;
+  G4VPhysicsConstructor*  fBiasingPhysics;
+  G4VPhysicsConstructor*  fImportanceWorldPhysics;
+  // one importance sampler and biasing constructor per particle, created once the parallel world exists
+  std::vector<G4GeometrySampler*> fImportanceSamplers;
+  std::vector<G4VPhysicsConstructor*> fImportancePhysics;
 
   // configurations 
   G4int  fPolStatus;
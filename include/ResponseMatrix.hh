@@ -0,0 +1,66 @@
+// ResponseMatrix.hh
+#ifndef ResponseMatrix_h
+#define ResponseMatrix_h 1
+
+#include <string>
+#include <vector>
+
+// Response of the polarimeter to monoenergetic photons on an energy grid for
+// both polarization signs: mean, variance and distribution of every response
+// column (energy in front of the calorimeter, crystal sums) per incident photon.
+// Written by leap_sims in response runs, read and folded with a spectrum by
+// leap_fold. Plain C++ without Geant4, the folding loops run over contiguous
+// arrays, so the compiler can vectorise them.
+struct ResponsePoint {
+    double energy = 0;            // MeV
+    int polSign = 1;              // +1 or -1
+    long nEvents = 0;
+    std::vector<double> mean;     // per column
+    std::vector<double> variance; // per column
+    std::vector<double> hist;     // row major nColumns x nBins, fraction of the events
+};
+
+struct FoldedResponse {
+    double norm = 0;               // sum of the spectrum weights on the grid
+    std::vector<double> mean;      // per column and incident photon
+    std::vector<double> meanError; // statistical error of the simulation
+    std::vector<double> variance;  // spread of the response per incident photon
+    std::vector<double> hist;      // row major nColumns x nBins
+};
+
+class ResponseMatrix {
+public:
+    ResponseMatrix();
+    ~ResponseMatrix();
+
+    void SetLayout(const std::vector<std::string>& columns, int nBins, double histMax);
+    void Clear();
+    void AddPoint(const ResponsePoint& point);
+
+    bool Write(const std::string& fileName) const;
+    bool Read(const std::string& fileName);
+
+    // energies of the points with the given polarization sign, in grid order
+    std::vector<double> GetEnergies(int polSign) const;
+    // weights of the grid points for a histogram spectrum: bin i covers
+    // (binEdges[i-1], binEdges[i]] with content binWeights[i], as /gps/hist/point
+    std::vector<double> GetSpectrumWeights(int polSign, const std::vector<double>& binEdges,
+                                           const std::vector<double>& binWeights) const;
+    FoldedResponse Fold(int polSign, const std::vector<double>& weights) const;
+
+    const std::vector<std::string>& GetColumns() const { return fColumns; }
+    int GetColumnIndex(const std::string& name) const;
+    int GetNBins() const { return fNBins; }
+    double GetHistMax() const { return fHistMax; }
+    std::size_t GetNPoints() const { return fPoints.size(); }
+
+private:
+    std::vector<const ResponsePoint*> GetPoints(int polSign) const;
+
+    std::vector<std::string> fColumns;
+    int fNBins = 0;
+    double fHistMax = 0;
+    std::vector<ResponsePoint> fPoints;
+};
+
+#endif // ResponseMatrix_h
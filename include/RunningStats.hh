@@ -0,0 +1,36 @@
+// RunningStats.hh
+#ifndef RunningStats_h
+#define RunningStats_h 1
+
+#include <vector>
+#include <cstddef>
+
+// Numerically stable running moments (Welford) of a fixed number of columns:
+// mean, variance and skewness of every column and the covariance between
+// all pairs of columns. The per column updates are plain loops over
+// contiguous arrays, so the compiler can vectorise them.
+class RunningStats {
+public:
+    RunningStats(std::size_t nColumns = 0);
+    ~RunningStats();
+
+    void Reset();
+    void Add(const std::vector<double>& row);
+
+    std::size_t GetNColumns() const { return fMean.size(); }
+    long GetN() const { return fN; }
+    double GetMean(std::size_t i) const { return fMean[i]; }
+    double GetVariance(std::size_t i) const;
+    double GetSkewness(std::size_t i) const;
+    double GetCovariance(std::size_t i, std::size_t j) const;
+
+private:
+    long fN = 0;
+    std::vector<double> fMean;
+    std::vector<double> fM2;
+    std::vector<double> fM3;
+    std::vector<double> fCoMoment; // row major nColumns x nColumns
+    std::vector<double> fDelta;    // scratch: deviation from the old mean
+};
+
+#endif // RunningStats_h
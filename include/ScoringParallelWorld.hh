@@ -0,0 +1,32 @@
+// ScoringParallelWorld.hh
+#ifndef ScoringParallelWorld_h
+#define ScoringParallelWorld_h 1
+
+#include "G4VUserParallelWorld.hh"
+#include "ConfigReader.hh"
+#include "AnaConfigManager.hh"
+
+#include <vector>
+
+class G4LogicalVolume;
+
+// thin scoring planes from [ScoringPlanes] in a parallel world, the mass geometry
+// and its navigation stay untouched. Needs G4ParallelWorldPhysics with the same world name.
+class ScoringParallelWorld : public G4VUserParallelWorld {
+public:
+    ScoringParallelWorld(const ConfigReader& config, AnaConfigManager& anaConfigManager);
+    ~ScoringParallelWorld() override;
+
+    void Construct() override;
+    void ConstructSD() override;
+
+    static const G4String& GetWorldName();
+
+private:
+    AnaConfigManager& fAnaConfigManager;
+    std::vector<ScoringPlaneInfo> fPlanes;
+    std::vector<G4LogicalVolume*> fLogicPlanes; // same order as fPlanes
+    std::vector<G4ThreeVector> fNormals; // direction in which particles are counted
+};
+
+#endif
@@ -0,0 +1,37 @@
+// ShowerGrid.hh
+#ifndef ShowerGrid_h
+#define ShowerGrid_h 1
+
+#include <vector>
+#include <cstddef>
+
+// Dense 3D grid of the energy deposition in every crystal, stored as one
+// flat array (cell, x, y, z). The coordinates are local to the crystal with
+// the origin in its centre. The bins that received energy are remembered, so
+// writing and resetting only touch those and not the whole grid.
+class ShowerGrid {
+public:
+    ShowerGrid();
+    ~ShowerGrid();
+
+    void Configure(int nCells, int nx, int ny, int nz, double halfXY, double halfZ);
+    void Reset();
+    void Add(int cell, double x, double y, double z, double edep);
+
+    int GetNz() const { return fNz; }
+    const std::vector<std::size_t>& GetFilledBins() const { return fFilled; }
+    double GetValue(std::size_t index) const { return fEdep[index]; }
+    void GetBin(std::size_t index, int& cell, int& ix, int& iy, int& iz) const;
+
+private:
+    int Bin(double value, double half, int n) const;
+
+    int fNCells = 0;
+    int fNx = 1, fNy = 1, fNz = 1;
+    double fHalfXY = 1.;
+    double fHalfZ = 1.;
+    std::vector<double> fEdep;
+    std::vector<std::size_t> fFilled;
+};
+
+#endif // ShowerGrid_h
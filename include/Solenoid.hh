@@ -18,6 +18,7 @@ public:
     G4LogicalVolume* ConstructSolenoid();
     void ConstructSolenoidSD();
     void ConstructSolenoidBfield();
+    void ConstructSolenoidBiasing();
     void SetBz(G4double newBz);
 
      // Getter method for magThick
@@ -37,6 +38,7 @@ private:
     G4int fLanexStatus;
     G4int fTableStatus;
     G4String fWorldMaterial;
+    G4String fDetailLevel; // full, reduced or minimal
     G4LogicalVolume* fLogicVacStep1;
     G4LogicalVolume* fLogicVacStep2;
     G4LogicalVolume* fLogicCore;
@@ -0,0 +1,53 @@
+#ifndef STACKINGACTION_HH
+#define STACKINGACTION_HH
+
+#include "G4UserStackingAction.hh"
+#include "AnaConfigManager.hh"
+#include "GpsPrimaryGeneratorAction.hh"
+
+#include <vector>
+
+class G4Event;
+class G4ParticleDefinition;
+class G4PrimaryTransformer;
+
+// [GPS] streamSize > 0: the primaries of an event are not all put on the stack
+// at the beginning, the next group is generated whenever the urgent stack is
+// empty. The peak number of tracks in memory scales with streamSize instead of
+// nBunch, and all groups belong to the same event, so the sensitive detector
+// sums are the ones of the whole bunch.
+//
+// [Stacking] status = 1: new secondaries are sorted into the stack classes
+// optical, low and high (kinetic energy below or above lowEnergy). Per class
+// they are processed first (urgent stack), deferred to the next stage (waiting
+// stack) or killed; above the cap of the class the stack it goes to is full and
+// the track is killed. Killed tracks and their energy are counted per event.
+class StackingAction : public G4UserStackingAction {
+public:
+    StackingAction(const ConfigReader& config, AnaConfigManager& anaConfigManager,
+                   leap::GpsPrimaryGeneratorAction* generator); // Constructor
+    virtual ~StackingAction(); // Destructor
+
+    // Overridden methods from G4UserStackingAction
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+    virtual void NewStage() override;
+    virtual void PrepareNewEvent() override;
+
+private:
+    int GetStackClass(const G4Track* track) const;
+
+    AnaConfigManager& fAnaConfigManager;
+    const int fStackingStatus;
+    const std::vector<StackClassInfo> fStackClasses;
+    std::vector<G4ClassificationOfNewTrack> fClassifications; // per stack class, fKill for the kill policy
+    G4double fLowEnergy;
+    const G4ParticleDefinition* fOpticalPhoton;
+
+    leap::GpsPrimaryGeneratorAction* fGenerator;
+    G4PrimaryTransformer* fTransformer;
+    // holds the primary vertices of the last injected group, G4PrimaryParticle
+    // is referenced by the tracks until they are deleted
+    G4Event* fStreamEvent = nullptr;
+};
+
+#endif // STACKINGACTION_HH
@@ -0,0 +1,23 @@
+#ifndef TRACKINGACTION_HH
+#define TRACKINGACTION_HH
+
+#include "G4UserTrackingAction.hh"
+#include "AnaConfigManager.hh"
+
+class G4Track;
+
+class TrackingAction : public G4UserTrackingAction {
+public:
+    TrackingAction(AnaConfigManager& anaConfigManager); // Constructor
+    virtual ~TrackingAction(); // Destructor
+
+    // Overridden methods from G4UserTrackingAction
+    virtual void PreUserTrackingAction(const G4Track*) override;
+
+private:
+    AnaConfigManager& fAnaConfigManager;
+    const int fTrackHistory;
+    const G4double fCpuBudget;
+};
+
+#endif // TRACKINGACTION_HH
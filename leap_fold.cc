@@ -0,0 +1,147 @@
+// leap_fold.cc
+// Folds a photon spectrum (the /gps/hist/point file of [GPS] histname) with the
+// response matrix of a response run and prints the expected calorimeter response
+// per incident photon for both polarization signs and the asymmetry, without
+// starting Geant4.
+
+#include "ResponseMatrix.hh"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  void PrintUsage() {
+    std::cerr << " Usage: " << std::endl;
+    std::cerr << " leap_fold -r responseFile -s spectrumFile [-o foldedHistFile]" << std::endl;
+  }
+
+  // reads "/gps/hist/point E weight" lines, plain "E weight" lines are also accepted
+  bool ReadSpectrum(const std::string& fileName, std::vector<double>& edges, std::vector<double>& weights) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+      std::cerr << "Unable to open spectrum file: " << fileName << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream iss(line);
+      std::string first;
+      if (!(iss >> first) || first[0] == '#') continue;
+      if (first[0] == '/') {
+        if (first != "/gps/hist/point") continue;
+      } else {
+        iss.clear();
+        iss.str(line);
+      }
+      double energy, weight;
+      if (iss >> energy >> weight) {
+        edges.push_back(energy);
+        weights.push_back(weight);
+      }
+    }
+    return edges.size() > 1;
+  }
+
+  double Asymmetry(double a, double errA, double b, double errB, double& error) {
+    error = 0.;
+    if (a + b == 0.) return 0.;
+    error = 2.*std::sqrt(b*b*errA*errA + a*a*errB*errB)/((a + b)*(a + b));
+    return (a - b)/(a + b);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::string responseFileName, spectrumFileName, outFileName;
+  for (int i = 1; i < argc; i = i + 2) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      PrintUsage();
+      return 1;
+    }
+    if (arg == "-r") {
+      responseFileName = argv[i + 1];
+    } else if (arg == "-s") {
+      spectrumFileName = argv[i + 1];
+    } else if (arg == "-o") {
+      outFileName = argv[i + 1];
+    } else {
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (responseFileName.empty() || spectrumFileName.empty()) {
+    PrintUsage();
+    return 1;
+  }
+
+  ResponseMatrix response;
+  if (!response.Read(responseFileName)) return 1;
+  std::vector<double> edges, binWeights;
+  if (!ReadSpectrum(spectrumFileName, edges, binWeights)) {
+    std::cerr << "No spectrum found in " << spectrumFileName << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<FoldedResponse> folded;
+  for (int sign : {1, -1}) {
+    folded.push_back(response.Fold(sign, response.GetSpectrumWeights(sign, edges, binWeights)));
+  }
+  double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // fraction of the spectrum which is covered by the energy grid
+  double total = 0.;
+  for (std::size_t i = 1; i < binWeights.size(); ++i) total += binWeights[i];
+  std::cout << "spectrum on the grid: " << (total > 0 ? folded[0].norm/total : 0.) << std::endl;
+  if (folded[0].norm <= 0. || folded[1].norm <= 0.) {
+    std::cerr << "The spectrum does not overlap with the energy grid of both polarization signs" << std::endl;
+    return 1;
+  }
+
+  const auto& columns = response.GetColumns();
+  std::cout << "column  mean(+)  error(+)  mean(-)  error(-)  asymmetry  error" << std::endl;
+  for (std::size_t c = 0; c < columns.size(); ++c) {
+    double error;
+    double asym = Asymmetry(folded[0].mean[c], folded[0].meanError[c], folded[1].mean[c], folded[1].meanError[c], error);
+    std::cout << columns[c] << "  " << folded[0].mean[c] << "  " << folded[0].meanError[c] << "  "
+              << folded[1].mean[c] << "  " << folded[1].meanError[c] << "  " << asym << "  " << error << std::endl;
+  }
+
+  // transmission ratio Edep/Ein as in the online asymmetry estimate (errors not propagated)
+  int iEin = response.GetColumnIndex("Ein");
+  int iEdep = response.GetColumnIndex("Edep");
+  if (iEin >= 0 && iEdep >= 0 && folded[0].mean[iEin] > 0 && folded[1].mean[iEin] > 0) {
+    double ratioPlus = folded[0].mean[iEdep]/folded[0].mean[iEin];
+    double ratioMinus = folded[1].mean[iEdep]/folded[1].mean[iEin];
+    double error;
+    std::cout << "ratio Edep/Ein  " << ratioPlus << "  " << ratioMinus << "  asymmetry "
+              << Asymmetry(ratioPlus, 0., ratioMinus, 0., error) << std::endl;
+  }
+  std::cout << "folding took " << elapsed << " ms" << std::endl;
+
+  // folded distributions, one line per column and polarization sign
+  if (!outFileName.empty()) {
+    std::ofstream out(outFileName);
+    if (!out.is_open()) {
+      std::cerr << "Unable to open output file: " << outFileName << std::endl;
+      return 1;
+    }
+    out << "bins " << response.GetNBins() << " 0 " << response.GetHistMax() << std::endl;
+    for (std::size_t s = 0; s < folded.size(); ++s) {
+      for (std::size_t c = 0; c < columns.size(); ++c) {
+        out << columns[c] << " " << (s == 0 ? 1 : -1);
+        for (int b = 0; b < response.GetNBins(); ++b) {
+          out << " " << folded[s].hist[c*response.GetNBins() + b];
+        }
+        out << std::endl;
+      }
+    }
+  }
+  return 0;
+}
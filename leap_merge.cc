@@ -0,0 +1,88 @@
+// leap_merge.cc
+// Merges the run<N>_<fileName>.root outputs of several jobs with the same
+// configuration into run<N>_<outName>.root, one output per run ID. The trees
+// are interpreted with the ConfigReader of the production (see OutputMerger).
+
+#include "ConfigReader.hh"
+#include "OutputMerger.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+  void PrintUsage() {
+    std::cerr << " Usage: " << std::endl;
+    std::cerr << " leap_merge -c configFile -o outName [-j nProcesses] [-f] file1.root file2.root ..." << std::endl;
+    std::cerr << " -f merges also files whose configurations differ" << std::endl;
+    std::cerr << " -j merges up to nProcesses run IDs at the same time, the files of one run ID are read one after the other" << std::endl;
+  }
+
+  // the run ID of run<N>_<name>.root, -1 for other file names
+  int GetRunID(const std::string& fileName) {
+    std::string baseName = fileName.substr(fileName.find_last_of('/') + 1);
+    if (baseName.rfind("run", 0) != 0) return -1;
+    std::size_t end = baseName.find('_');
+    if (end == std::string::npos || end == 3) return -1;
+    std::string number = baseName.substr(3, end - 3);
+    if (number.find_first_not_of("0123456789") != std::string::npos) return -1;
+    return std::atoi(number.c_str());
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::string configFileName, outName;
+  int nProcesses = 1;
+  bool checkConfig = true;
+  std::vector<std::string> inFiles;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-f") {
+      checkConfig = false;
+    } else if (arg == "-c" || arg == "-o" || arg == "-j") {
+      if (i + 1 >= argc) {
+        PrintUsage();
+        return 1;
+      }
+      std::string value = argv[++i];
+      if (arg == "-c") {
+        configFileName = value;
+      } else if (arg == "-o") {
+        outName = value;
+      } else {
+        nProcesses = std::atoi(value.c_str());
+      }
+    } else if (arg[0] == '-') {
+      PrintUsage();
+      return 1;
+    } else {
+      inFiles.push_back(arg);
+    }
+  }
+  if (configFileName.empty() || outName.empty() || inFiles.empty() || nProcesses < 1) {
+    PrintUsage();
+    return 1;
+  }
+
+  ConfigReader config(configFileName);
+  if (!config.ReadConfig()) {
+    std::cerr << "Failed to read configuration file." << std::endl;
+    return 1;
+  }
+
+  // the files of one run ID are merged together, files without run ID into outName
+  std::map<std::string, std::vector<std::string>> groups;
+  for (const auto& inFile : inFiles) {
+    int runID = GetRunID(inFile);
+    std::string target = runID < 0 ? outName : "run" + std::to_string(runID) + "_" + outName;
+    groups[target].push_back(inFile);
+  }
+  for (const auto& group : groups) {
+    std::cout << group.first << ".root <- " << group.second.size() << " files" << std::endl;
+  }
+
+  return OutputMerger::MergeGroups(config, groups, nProcesses, checkConfig) ? 0 : 1;
+}
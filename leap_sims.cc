@@ -36,18 +36,60 @@
 //~~~~~~~~~~~~~~~~~~~~~~~~
 #include "RunAction.hh"
 #include "EventAction.hh"
+#include "TrackingAction.hh"
+#include "StackingAction.hh"
 #include "MacroGenerator.hh"
 #include "AnaConfigManager.hh"
 #include "GpsPrimaryGeneratorAction.hh"
+#include "FastTransmissionModel.hh"
+#include "OutputMerger.hh"
 
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"
+#include "G4UIcommandStatus.hh"
 #include "G4UIExecutive.hh"
 #include "G4VisExecutive.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sys/wait.h>
+#include <unistd.h>
+
 namespace leap {
   void PrintUsage() {
     G4cerr << " Usage: " << G4endl;
-    G4cerr << " leap_sims [-c configFileName of type string] [-v visualState of type bool]"  << G4endl;
+    G4cerr << " leap_sims [-c configFileName of type string] [-v visualState of type bool] [-j number of worker processes]"  << G4endl;
+    G4cerr << "           [--job-index index of this job --job-count number of jobs]"  << G4endl;
+  }
+
+  // -j N: the output files of the workers are merged into the usual run<N>_<fileName>.root,
+  // they are kept if they also hold trees which are not merged (see OutputMerger)
+  bool MergeWorkerFiles(const ConfigReader& config, const G4String& fileName, int nRuns, int nWorkers, bool keep) {
+    std::map<std::string, std::vector<std::string>> groups;
+    for (int run = 0; run < nRuns; ++run) {
+      G4String target = "run" + std::to_string(run) + "_" + fileName;
+      for (int i = 0; i < nWorkers; ++i) {
+        groups[target].push_back(target + "_w" + std::to_string(i) + ".root");
+      }
+    }
+    if (!OutputMerger::MergeGroups(config, groups, nWorkers, true)) {
+      G4cerr << "Merging the worker files failed, they are kept" << G4endl;
+      return false;
+    }
+    if (keep) {
+      G4cout << "----> The worker files are kept, their cluster, abort, track, paired, stack and shower trees are not merged" << G4endl;
+      return true;
+    }
+    for (const auto& group : groups) {
+      for (const auto& workerFile : group.second) {
+        std::remove(workerFile.c_str());
+      }
+    }
+    return true;
   }
 }
 
@@ -58,6 +100,9 @@ int main(int argc,char** argv)
   // Get config name and visualization based on input or set default values 
   G4String configFileName;
   bool visualState = false; // Use bool for visualState
+  int nWorkers = 1;
+  int jobIndex = -1;
+  int jobCount = 0;
   for (G4int i = 1; i < argc; i = i + 2) {
     if (G4String(argv[i]) == "-c") {
       configFileName = argv[i + 1];
@@ -72,12 +117,27 @@ int main(int argc,char** argv)
         PrintUsage(); // Invalid value for -v
         return 1;
       } 
+    } else if (G4String(argv[i]) == "-j") {
+      nWorkers = std::atoi(argv[i + 1]);
+      if (nWorkers < 1) {
+        PrintUsage();
+        return 1;
+      }
+    } else if (G4String(argv[i]) == "--job-index") {
+      jobIndex = std::atoi(argv[i + 1]);
+    } else if (G4String(argv[i]) == "--job-count") {
+      jobCount = std::atoi(argv[i + 1]);
     } else {
       PrintUsage();
       return 1;
     }
   }
   if (configFileName.empty()) { configFileName = "config.ini"; }
+  // split production: both options or none
+  if ((jobIndex >= 0 || jobCount > 0) && (jobIndex < 0 || jobIndex >= jobCount)) {
+    PrintUsage();
+    return 1;
+  }
 
   // Read the configuration file 
   ConfigReader config(configFileName);
@@ -116,10 +176,17 @@ int main(int argc,char** argv)
   
 
   // Set user action class
-  runManager->SetUserAction(new GpsPrimaryGeneratorAction());
+  GpsPrimaryGeneratorAction* generator = new GpsPrimaryGeneratorAction(config);
+  runManager->SetUserAction(generator);
   RunAction* run ;
   runManager->SetUserAction(run = new RunAction(ana));
   runManager->SetUserAction(new EventAction(ana));
+  if (ana.GetTrackHistoryStatus() || ana.GetCpuBudget() > 0) {
+    runManager->SetUserAction(new TrackingAction(ana));
+  }
+  if (generator->GetStreamSize() > 0 || ana.GetStackingStatus()) {
+    runManager->SetUserAction(new StackingAction(config, ana, generator));
+  }
 
   // Initialize the run manager 
   runManager->Initialize();
@@ -137,10 +204,138 @@ int main(int argc,char** argv)
 
   // Process macro or start UI session
   //
-  if ( ! ui ) {
+  // -j N: only the run types with the same runs in every worker are split,
+  // the stats moments of the workers are not merged and the precision target
+  // of the asymmetry needs all events of a run in one estimator
+  G4String runType = config.GetConfigValue("Run","type");
+  if (nWorkers > 1 && (ui || runType == "fastscan" || runType == "response" || config.ReadOutputMode() == "stats"
+                       || config.ReadAsymPrecision() > 0)) {
+    G4cout << "----> -j is only used in batch mode for the run types single and asymmetry, not for the output mode stats"
+           << " and not with [Run] absPrecision, running one process" << G4endl;
+    nWorkers = 1;
+  }
+  if (jobCount > 0 && (ui || runType == "fastscan")) {
+    G4cerr << "--job-index and --job-count are only used in batch mode and not for fastscan" << G4endl;
+    delete visManager;
+    delete runManager;
+    return 1;
+  }
+
+  int exitCode = 0;
+  if ( ! ui && (nWorkers > 1 || jobCount > 0)) {
+    // batch mode with worker processes: geometry and physics tables are built
+    // once, the forked workers share them copy-on-write and simulate their
+    // share of the events of every run with their own random stream.
+    // Job i of a split production simulates Nevents events of every run from
+    // the event ID i*Nevents (rounded up to whole blocks), also with one worker
+    G4String command = "/control/execute ";
+    std::vector<long> firstEvents;
+    long eventsPerJob = 0;
+    int nRuns = MacroGenerator::generateWorkerMacros(config, macroFileName, nWorkers, firstEvents, eventsPerJob);
+    if (nRuns == 0) {
+      delete visManager;
+      delete runManager;
+      return 1;
+    }
+    // the event IDs of G4Event are int
+    if (std::max(jobCount, 1)*eventsPerJob > std::numeric_limits<G4int>::max()) {
+      G4cerr << "The event IDs of " << std::max(jobCount, 1) << " jobs with " << eventsPerJob
+             << " events per run do not fit into an int" << G4endl;
+      delete visManager;
+      delete runManager;
+      return 1;
+    }
+    G4String macroBase = "macro_" + identifier;
+    UImanager->ApplyCommand(command + macroBase + "_setup.mac");
+
+    // one stream per job and worker from the master seeds [RandomSeeds]: MixMax
+    // maps distinct sets of four seeds to streams which do not overlap
+    long masterSeed1 = config.GetConfigValueAsInt("RandomSeeds","rndsds1");
+    long masterSeed2 = config.GetConfigValueAsInt("RandomSeeds","rndsds2");
+    long jobOffset = 0;
+    if (jobCount > 0) {
+      jobOffset = jobIndex*eventsPerJob;
+      ana.SetOutputSuffix("_job" + std::to_string(jobIndex));
+      ana.AddJobMetadata("Job.index", std::to_string(jobIndex));
+      ana.AddJobMetadata("Job.count", std::to_string(jobCount));
+      ana.AddJobMetadata("Job.masterSeeds", std::to_string(masterSeed1) + " " + std::to_string(masterSeed2));
+    }
+
+    // buffered output of the setup would otherwise be written again by every worker
+    G4cout << std::flush;
+    std::cout.flush();
+    std::vector<pid_t> workers;
+    int workerIndex = nWorkers > 1 ? -1 : 0;
+    for (int i = 0; i < nWorkers && nWorkers > 1; ++i) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        workerIndex = i;
+        break;
+      }
+      if (pid < 0) {
+        G4cerr << "Could not start worker " << i << G4endl;
+        exitCode = 1;
+        break;
+      }
+      workers.push_back(pid);
+    }
+
+    if (workerIndex >= 0) {
+      // checked above to fit into the int event IDs
+      G4int eventIDOffset = G4int(jobOffset + firstEvents[workerIndex]);
+      long seeds[4] = {masterSeed1, masterSeed2, std::max(jobIndex, 0) + 1, workerIndex + 1};
+      G4Random::setTheSeeds(seeds, 4);
+      generator->SetEventIDOffset(eventIDOffset);
+      ana.SetEventIDOffset(eventIDOffset);
+      if (nWorkers > 1) {
+        ana.SetOutputSuffix("_w" + std::to_string(workerIndex));
+      }
+      ana.AddJobMetadata("Job.worker", std::to_string(workerIndex));
+      ana.AddJobMetadata("Job.nWorkers", std::to_string(nWorkers));
+      ana.AddJobMetadata("Job.seeds", std::to_string(seeds[0]) + " " + std::to_string(seeds[1]) + " "
+                                      + std::to_string(seeds[2]) + " " + std::to_string(seeds[3]));
+      ana.AddJobMetadata("Job.eventIDOffset", std::to_string(eventIDOffset));
+      // a failed worker macro fails the merge in the parent
+      if (UImanager->ApplyCommand(command + macroBase + "_w" + std::to_string(workerIndex) + ".mac") != fCommandSucceeded) {
+        G4cerr << "Worker " << workerIndex << ": macro failed" << G4endl;
+        exitCode = 1;
+      }
+    } else if (nWorkers > 1) {
+      for (pid_t pid : workers) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+          G4cerr << "Worker process " << pid << " failed" << G4endl;
+          exitCode = 1;
+        }
+      }
+      bool keep = ana.GetClusterStatus() || ana.GetAbortStatus() || ana.GetTrackHistoryStatus() || ana.GetPairedStatus()
+                  || ana.GetStackingStatus() || ana.GetShowerDevStat() == 2;
+      if (exitCode == 0 && !MergeWorkerFiles(config, ana.GetOutputFileName(), nRuns, nWorkers, keep)) {
+        exitCode = 1;
+      }
+    }
+  }
+  else if ( ! ui ) {
     // batch mode
     G4String command = "/control/execute ";
     UImanager->ApplyCommand(command+macroFileName);
+
+    // fastscan: the model needs the physics tables of the macro run above,
+    // the chosen points are then cross-checked with the full simulation
+    if (runType == "fastscan") {
+      FastTransmissionModel model(config);
+      model.RunScan();
+      std::vector<FastTransmissionModel::ScanPoint> points = model.GetCrossCheckPoints();
+      if (config.ReadCrossCheckEvents() > 0 && !points.empty()) {
+        std::vector<G4double> predictions;
+        for (const auto& point : points) { predictions.push_back(point.asymE); }
+        ana.SetFastPredictions(predictions);
+        G4String crossCheckMacro = "macro_" + identifier + "_crosscheck.mac";
+        MacroGenerator::generateCrossCheckMacro(config, points, crossCheckMacro);
+        UImanager->ApplyCommand(command+crossCheckMacro);
+      }
+    }
   }
   else {
     // interactive mode
@@ -155,4 +350,5 @@ int main(int argc,char** argv)
   // in the main() program !
   delete visManager;
   delete runManager;
+  return exitCode;
 }
@@ -1,11 +1,20 @@
 # include "AnaConfigManager.hh"
 # include "ConfigReader.hh"
+#include "CaloCrystalSD.hh"
 #include <vector>
 #include "G4Run.hh"
 #include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4StackedTrack.hh"
+#include "G4VProcess.hh"
 #include "G4RunManager.hh"
+#include "G4Event.hh"
 #include "G4AnalysisManager.hh"
+#include "G4NavigationHistory.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Exception.hh"
+#include <cmath>
 
 AnaConfigManager::AnaConfigManager(const ConfigReader& config)
   : fConfig(config),
@@ -14,9 +23,74 @@ AnaConfigManager::AnaConfigManager(const ConfigReader& config)
     fTreesInfo(config.ReadTreesInfo()),
     fHistoInfo(config.ReadHistoInfo()),
     fEinLim(config.ReadEinLim()),
-    fShowerDevStat(config.ReadShowerDevStat()) {
+    fShowerDevStat(config.ReadShowerDevStat()),
+    fBlockSize(config.ReadBlockSize()),
+    fSparseStatus(config.ReadSparseStatus()),
+    fDetailedLayout(config.ReadDetailedLayout()),
+    fTriggerStatus(config.ReadTriggerStatus()),
+    fTrackHistory(config.ReadTrackHistoryStatus()),
+    fClusterStatus(config.ReadClusterStatus()),
+    fNCrystals(config.ReadNCrystalsX()*config.ReadNCrystalsY()),
+    fShowerWrite(config.GetConfigValue("Calorimeter", "showerWrite") == "event" ? "event" : "run"),
+    fPairedStatus(config.ReadPairedStatus()),
+    fAsymPrecision(config.ReadAsymPrecision()),
+    fAsymCheckEvery(config.ReadIntOrDefault("Run", "checkEvery", 1000)),
+    fAsymMaxEvents(config.ReadIntOrDefault("Run", "maxEvents", config.GetConfigValueAsInt("Run", "Nevents"))),
+    fAsymUseFront(config.ReadIntOrDefault("Calorimeter", "frontDetector", 0)),
+    fAsymEstimate(fAsymPrecision > 0 || config.ReadCrossCheckEvents() > 0),
+    fResponseStatus(config.ReadResponseStatus()),
+    fResponseEnergies(config.ReadResponseEnergies()),
+    fWeightStatus(config.ReadWeightStatus()),
+    fStackingStatus(config.ReadStackingStatus()),
+    fStackClasses(config.ReadStackClasses()) {
 
     G4cout << "\n----> The output mode is " << fOutputMode << "\n" << G4endl;
+    // the chunks of a bunch are only reduced into one result by summing them
+    int nChunks = config.ReadBunchChunks();
+    if (nChunks > 1 && fOutputMode != "block" && fOutputMode != "SumRun") {
+        G4String description = "[GPS] nChunks > 1 needs the output mode block or SumRun, which sum the chunks of a bunch.";
+        G4Exception("AnaConfigManager", "InvalidBunchChunks", FatalException, description);
+    }
+    int configBlockSize = config.ReadIntOrDefault("Output", "blockSize", 1);
+    if (nChunks > 1 && fOutputMode == "block" && !config.GetConfigValue("Output", "blockSize").empty()
+        && configBlockSize != fBlockSize) {
+        G4cout << "----> [Output] blockSize " << configBlockSize << " is replaced by nChunks = " << fBlockSize
+               << ", every row holds the sums of one bunch" << G4endl;
+    }
+    if (!config.GetConfigValue("Abort", "crystEdepMax").empty()) {
+        fAbortCrystEdep = config.GetConfigValueAsDouble("Abort", "crystEdepMax")*CLHEP::MeV;
+    }
+    fAbortMaxCrossings = config.ReadIntOrDefault("Abort", "maxCrossings", 0);
+    if (!config.GetConfigValue("Abort", "cpuBudget").empty()) {
+        fAbortCpuBudget = config.GetConfigValueAsDouble("Abort", "cpuBudget");
+    }
+    fAbortStatus = fEinLim != 0 || fAbortCrystEdep > 0 || fAbortMaxCrossings > 0 || fAbortCpuBudget > 0;
+
+    if (fTriggerStatus) {
+        if (!config.GetConfigValue("Trigger", "caloEdepMin").empty()) {
+            fTrigEdepMin = config.GetConfigValueAsDouble("Trigger", "caloEdepMin")*CLHEP::MeV;
+        }
+        fTrigFrontHit = config.ReadIntOrDefault("Trigger", "requireFrontHit", 0);
+        G4cout << "----> Trigger: crystal Edep >= " << fTrigEdepMin << " MeV, front hit required " << fTrigFrontHit << G4endl;
+    }
+    if (fAsymPrecision > 0) {
+        G4cout << "----> Runs stop once the absolute asymmetry error reaches " << fAsymPrecision << G4endl;
+    }
+    if (fResponseStatus) {
+        fResponseNBins = config.ReadIntOrDefault("Response", "nBins", 100);
+        if (!config.GetConfigValue("Response", "histMax").empty()) {
+            fResponseHistMax = config.GetConfigValueAsDouble("Response", "histMax");
+        } else if (!fResponseEnergies.empty()) {
+            fResponseHistMax = fResponseEnergies.back();
+        }
+        std::vector<std::string> columns = {"Ein", "Edep"};
+        for (int i = 0; i < fNCrystals; ++i) {
+            columns.push_back("Edep_" + std::to_string(i));
+        }
+        fResponse.SetLayout(columns, fResponseNBins, fResponseHistMax);
+        G4cout << "----> Response runs for " << fResponseEnergies.size() << " photon energies" << G4endl;
+    }
+    fFomStatus = fWeightStatus && fOutputMode != "SumRun" && fOutputMode != "block";
 
     G4cout << "\n----> The registered detectors are :" << G4endl;
     for (const auto& treeInfo : fTreesInfo) {
@@ -48,25 +122,279 @@ void AnaConfigManager::SetUp( const G4Run* aRun,
     // Create the histograms
     BookHistos();
 
+    // stats mode: running moments instead of per event rows
+    if (fOutputMode == "stats") {
+        BookStats();
+    }
+
+    // one cluster per event from the crystal sums and the hits in front of the calorimeter
+    if (fClusterStatus) {
+        fClusterTupleID = analysisManager->CreateNtuple("CaloCluster", "calorimeter cluster per event");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "Etot");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "xc");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "yc");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "sxx");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "syy");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "sxy");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "Emax");
+        analysisManager->CreateNtupleIColumn(fClusterTupleID, "crystMax");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "EmaxOverE3x3");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "Ein");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "xin");
+        analysisManager->CreateNtupleDColumn(fClusterTupleID, "yin");
+        analysisManager->CreateNtupleIColumn(fClusterTupleID, "EventID");
+        analysisManager->FinishNtuple(fClusterTupleID);
+    }
+
+    // aborted events and the reason
+    if (fAbortStatus) {
+        fAbortTupleID = analysisManager->CreateNtuple("Aborted", "aborted events");
+        analysisManager->CreateNtupleIColumn(fAbortTupleID, "EventID");
+        analysisManager->CreateNtupleSColumn(fAbortTupleID, "reason");
+        analysisManager->FinishNtuple(fAbortTupleID);
+        fAbortCounts.clear();
+    }
+
+    // one row per track with hits and its ancestors, the hit rows refer to it by the TrackID
+    if (fTrackHistory) {
+        fTrackHistoryTupleID = analysisManager->CreateNtuple("TrackHistory", "tracks with hits and their ancestors");
+        analysisManager->CreateNtupleIColumn(fTrackHistoryTupleID, "EventID");
+        analysisManager->CreateNtupleIColumn(fTrackHistoryTupleID, "TrackID");
+        analysisManager->CreateNtupleIColumn(fTrackHistoryTupleID, "ParentID");
+        analysisManager->CreateNtupleIColumn(fTrackHistoryTupleID, "pdg");
+        analysisManager->CreateNtupleDColumn(fTrackHistoryTupleID, "startx");
+        analysisManager->CreateNtupleDColumn(fTrackHistoryTupleID, "starty");
+        analysisManager->CreateNtupleDColumn(fTrackHistoryTupleID, "startz");
+        analysisManager->CreateNtupleDColumn(fTrackHistoryTupleID, "Ekin");
+        analysisManager->CreateNtupleSColumn(fTrackHistoryTupleID, "process");
+        analysisManager->FinishNtuple(fTrackHistoryTupleID);
+        fTrackRecords.clear();
+    }
+
+    // showerDev = 2: voxelised shower development instead of per step rows
+    if (fShowerDevStat == 2 && fCrystThick > 0) {
+        BookShowerGrid();
+    }
+
+    fRunID = aRun->GetRunID();
+    fPolState = aRun->GetRunID() % 2;
+    if (fResponseStatus) {
+        std::size_t nColumns = fResponse.GetColumns().size();
+        fResponseStats = RunningStats(nColumns);
+        fResponseHist.assign(nColumns*fResponseNBins, 0.);
+        if (fRunID == 0) {
+            fResponse.Clear();
+        }
+    }
+    if (fFomStatus) {
+        fFomStats = RunningStats(2);
+        fRunStartClock = std::clock();
+    }
+    // per event stack depth and the tracks killed by the stacking policy
+    if (fStackingStatus) {
+        fStackTupleID = analysisManager->CreateNtuple("StackStats", "stack depth and stacking policy per event");
+        analysisManager->CreateNtupleIColumn(fStackTupleID, "EventID");
+        analysisManager->CreateNtupleIColumn(fStackTupleID, "peakDepth");
+        analysisManager->CreateNtupleDColumn(fStackTupleID, "peakMemory");
+        for (const auto& stackClass : fStackClasses) {
+            analysisManager->CreateNtupleIColumn(fStackTupleID, "nStacked_" + stackClass.name);
+            analysisManager->CreateNtupleIColumn(fStackTupleID, "nKilled_" + stackClass.name);
+            analysisManager->CreateNtupleDColumn(fStackTupleID, "EKilled_" + stackClass.name);
+        }
+        analysisManager->FinishNtuple(fStackTupleID);
+        fStackRunPeakDepth = 0;
+        fRunKilledTracks.assign(fStackClasses.size(), 0);
+        fRunKilledEnergy.assign(fStackClasses.size(), 0.);
+    }
+    fRunMetadata.clear();
+    fSkippedRows.clear();
+    fTrigEvents = 0;
+    fTrigAccepted = 0;
+    fHitRowBuffer.clear();
+
+    // the second run of a pair gets the table with the per event differences
+    if (fPairedStatus) {
+        if (fPolState == 0) {
+            fPairedReference.clear();
+        } else {
+            fPairedTupleID = analysisManager->CreateNtuple("PairedDiff", "per event difference of the paired runs");
+            analysisManager->CreateNtupleIColumn(fPairedTupleID, "EventID");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "Edep_run0");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "Edep_run1");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "dEdep");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "Ein_run0");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "Ein_run1");
+            analysisManager->CreateNtupleDColumn(fPairedTupleID, "dEin");
+            analysisManager->FinishNtuple(fPairedTupleID);
+        }
+    }
+
+    if (fAsymEstimate) {
+        if (fPolState == 0) {
+            fAsymEstimator.Reset();
+        } else {
+            fAsymEstimator.ResetState(fPolState);
+        }
+        fAsymStopReason = "";
+    }
+
 };
 
 void AnaConfigManager::BookNtuples() {
     G4cout << "Booking Ntuples ..." << G4endl;
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    fHitEventColumn.clear();
     for (const auto& treeInfo : fTreesInfo) {
         analysisManager->CreateNtuple(treeInfo.name, treeInfo.title);
         auto branchesInfo = fConfig.GetBranchesInfo(treeInfo.name);
+
+        // vector layout: one row per event, the hits are collected in vector columns
+        G4bool isHitTuple = fOutputMode == "detailed" || (treeInfo.name == "CaloCrystal" && HasCrystalHitTuple());
+        if (fDetailedLayout == "vector" && isHitTuple) {
+            BookHitVectors(treeInfo.id, branchesInfo);
+            analysisManager->FinishNtuple();
+            auto& types = fColumnTypes[treeInfo.id];
+            types.clear();
+            for (const auto& branchInfo : branchesInfo) {
+                types.push_back(branchInfo.type);
+            }
+            continue;
+        }
+
         for (const auto& branchInfo : branchesInfo) {
             if (branchInfo.type == "D") {
                 analysisManager->CreateNtupleDColumn(treeInfo.id,branchInfo.name);
             } else if (branchInfo.type == "I") {
                 analysisManager->CreateNtupleIColumn(treeInfo.id,branchInfo.name);
+            } else if (branchInfo.type == "S") {
+                analysisManager->CreateNtupleSColumn(treeInfo.id,branchInfo.name);
             }
         }
         analysisManager->FinishNtuple();
+
+        // remember the column types, the summary rows are filled generically
+        auto& types = fColumnTypes[treeInfo.id];
+        types.clear();
+        for (const auto& branchInfo : branchesInfo) {
+            types.push_back(branchInfo.type);
+        }
+    }
+};
+
+void AnaConfigManager::BookHitVectors(int tupleID, const std::vector<BranchInfo>& branchesInfo) {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    // the columns are bound to the buffers, so these must not be resized after booking
+    auto& bufferF = fHitBufferF[tupleID];
+    auto& bufferI = fHitBufferI[tupleID];
+    bufferF.assign(branchesInfo.size(), std::vector<float>());
+    bufferI.assign(branchesInfo.size(), std::vector<int>());
+    for (std::size_t i = 0; i < branchesInfo.size(); ++i) {
+        const auto& branchInfo = branchesInfo[i];
+        if (branchInfo.name == "EventID") { // stays a scalar column
+            fHitEventColumn[tupleID] = i;
+            if (branchInfo.type == "D") {
+                analysisManager->CreateNtupleDColumn(tupleID, branchInfo.name);
+            } else {
+                analysisManager->CreateNtupleIColumn(tupleID, branchInfo.name);
+            }
+        } else if (branchInfo.type == "D") {
+            analysisManager->CreateNtupleFColumn(tupleID, branchInfo.name, bufferF[i]);
+        } else if (branchInfo.type == "I") {
+            analysisManager->CreateNtupleIColumn(tupleID, branchInfo.name, bufferI[i]);
+        }
+    }
+};
+
+void AnaConfigManager::BookStats() {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    fStats.clear();
+    fStatsColumns.clear();
+    fStatsCovTupleID.clear();
+    for (const auto& treeInfo : fTreesInfo) {
+        // the per step shower development is never reduced to sums
+        if (treeInfo.name == "CaloCrystal" && HasCrystalHitTuple()) continue;
+
+        std::vector<std::string> names;
+        for (const auto& branchInfo : fConfig.GetSummaryBranchesInfo(treeInfo.name)) {
+            names.push_back(branchInfo.name);
+        }
+        fStats[treeInfo.id] = RunningStats(names.size());
+        fStatsColumns[treeInfo.id] = names;
+
+        // covariance between all pairs of summary columns
+        int covID = analysisManager->CreateNtuple(treeInfo.name + "_cov", treeInfo.title + " covariance");
+        analysisManager->CreateNtupleSColumn(covID, "x");
+        analysisManager->CreateNtupleSColumn(covID, "y");
+        analysisManager->CreateNtupleDColumn(covID, "cov");
+        analysisManager->FinishNtuple(covID);
+        fStatsCovTupleID[treeInfo.id] = covID;
+    }
+};
+
+void AnaConfigManager::WriteStats() {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    for (const auto& entry : fStats) {
+        int tupleID = entry.first;
+        const RunningStats& stats = entry.second;
+        const auto& names = fStatsColumns[tupleID];
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            analysisManager->FillNtupleSColumn(tupleID, 0, names[i]);
+            analysisManager->FillNtupleIColumn(tupleID, 1, stats.GetN());
+            analysisManager->FillNtupleDColumn(tupleID, 2, stats.GetMean(i));
+            analysisManager->FillNtupleDColumn(tupleID, 3, stats.GetVariance(i));
+            analysisManager->FillNtupleDColumn(tupleID, 4, stats.GetSkewness(i));
+            analysisManager->AddNtupleRow(tupleID);
+        }
+        int covID = fStatsCovTupleID[tupleID];
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            for (std::size_t j = i+1; j < names.size(); ++j) {
+                analysisManager->FillNtupleSColumn(covID, 0, names[i]);
+                analysisManager->FillNtupleSColumn(covID, 1, names[j]);
+                analysisManager->FillNtupleDColumn(covID, 2, stats.GetCovariance(i, j));
+                analysisManager->AddNtupleRow(covID);
+            }
+        }
     }
 };
 
+void AnaConfigManager::AddSummaryRow(int tupleID, const std::vector<G4double>& row) {
+    // stats mode: only the running moments are updated
+    if (fOutputMode == "stats") {
+        auto it = fStats.find(tupleID);
+        if (it != fStats.end()) {
+            it->second.Add(row);
+        }
+        return;
+    }
+    if (fSparseStatus) {
+        G4bool empty = true;
+        for (const auto& value : row) {
+            if (value != 0) { empty = false; break; }
+        }
+        if (empty) {
+            fSkippedRows[tupleID] += 1;
+            return;
+        }
+    }
+
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    const auto& types = fColumnTypes[tupleID];
+    for (std::size_t i = 0; i < row.size(); ++i) {
+        if (types[i] == "I") {
+            analysisManager->FillNtupleIColumn(tupleID, i, int(row[i]));
+        } else {
+            analysisManager->FillNtupleDColumn(tupleID, i, row[i]);
+        }
+    }
+    if (fOutputMode == "block") {
+        analysisManager->FillNtupleIColumn(tupleID, row.size(), fBlockEvents);
+    } else if (fSparseStatus) {
+        int eventID = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
+        analysisManager->FillNtupleIColumn(tupleID, row.size(), eventID);
+    }
+    analysisManager->AddNtupleRow(tupleID);
+};
+
 void AnaConfigManager::BookHistos(){
     // Get the number of bins for both types of histograms
     double binWidthE = fConfig.GetConfigValueAsDouble("Output","binWidthE");
@@ -151,39 +479,47 @@ void AnaConfigManager::Save() const {
 
 };
 
-void AnaConfigManager::FillBaseNtuple_detailed(int tupleID, G4Step* step) const {
-    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+void AnaConfigManager::FillBaseNtuple_detailed(int tupleID, G4Step* step) {
     auto track = step->GetTrack();
     auto PSP = step->GetPostStepPoint();
-    analysisManager->FillNtupleIColumn(tupleID,0, track->GetParticleDefinition()->GetPDGEncoding());
+    int col = 0;
+    FillHitColumn(tupleID, col++, track->GetParticleDefinition()->GetPDGEncoding());
 
-    analysisManager->FillNtupleDColumn(tupleID,1, PSP->GetTotalEnergy()/CLHEP::MeV);
+    FillHitColumn(tupleID, col++, PSP->GetTotalEnergy()/CLHEP::MeV);
 
-    analysisManager->FillNtupleDColumn(tupleID,2, PSP->GetPosition().x());
-    analysisManager->FillNtupleDColumn(tupleID,3, PSP->GetPosition().y());
-    analysisManager->FillNtupleDColumn(tupleID,4, PSP->GetPosition().z());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().x());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().y());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,5, track->GetVertexPosition().x());
-    analysisManager->FillNtupleDColumn(tupleID,6, track->GetVertexPosition().y());
-    analysisManager->FillNtupleDColumn(tupleID,7, track->GetVertexPosition().z());
+    if (!fTrackHistory) { // otherwise in the TrackHistory tree
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().x());
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().y());
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().z());
+    }
 
-    analysisManager->FillNtupleDColumn(tupleID,8, PSP->GetMomentumDirection().x());
-    analysisManager->FillNtupleDColumn(tupleID,9, PSP->GetMomentumDirection().y());
-    analysisManager->FillNtupleDColumn(tupleID,10, PSP->GetMomentumDirection().z());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().x());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().y());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,11, track->GetPolarization().x());
-    analysisManager->FillNtupleDColumn(tupleID,12, track->GetPolarization().y());
-    analysisManager->FillNtupleDColumn(tupleID,13, track->GetPolarization().z());
+    FillHitColumn(tupleID, col++, track->GetPolarization().x());
+    FillHitColumn(tupleID, col++, track->GetPolarization().y());
+    FillHitColumn(tupleID, col++, track->GetPolarization().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,14, track->GetTrackID());
-    analysisManager->FillNtupleDColumn(tupleID,15, track->GetParentID());
-    analysisManager->FillNtupleDColumn(tupleID,16, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    FillHitColumn(tupleID, col++, track->GetTrackID());
+    if (!fTrackHistory) {
+        FillHitColumn(tupleID, col++, track->GetParentID());
+    } else {
+        MarkTrack(track->GetTrackID());
+    }
+    FillHitColumn(tupleID, col++, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    if (fWeightStatus) {
+        FillHitColumn(tupleID, col++, track->GetWeight());
+    }
 
-    analysisManager->AddNtupleRow(tupleID);
+    AddHitRow(tupleID);
 };
 
-void AnaConfigManager::FillCaloFrontTuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) const {
-    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+void AnaConfigManager::FillCaloFrontTuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) {
     auto track = step->GetTrack();
     auto PSP = step->GetPostStepPoint();
     int motherdepth = 1;
@@ -191,99 +527,680 @@ void AnaConfigManager::FillCaloFrontTuple_detailed(int tupleID,const G4VTouchabl
         motherdepth = 1;// changed the mother volume of the Vacstep4 to calovirtuel volume so not motherdepth = 2 ( for Alu as mother) but same as Fontdetector 1
     }
 
-    analysisManager->FillNtupleIColumn(tupleID,0, track->GetParticleDefinition()->GetPDGEncoding());
+    int col = 0;
+    FillHitColumn(tupleID, col++, track->GetParticleDefinition()->GetPDGEncoding());
 
-    analysisManager->FillNtupleDColumn(tupleID,1, PSP->GetTotalEnergy()/CLHEP::MeV);
+    FillHitColumn(tupleID, col++, PSP->GetTotalEnergy()/CLHEP::MeV);
 
-    analysisManager->FillNtupleDColumn(tupleID,2, PSP->GetPosition().x());
-    analysisManager->FillNtupleDColumn(tupleID,3, PSP->GetPosition().y());
-    analysisManager->FillNtupleDColumn(tupleID,4, PSP->GetPosition().z());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().x());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().y());
+    FillHitColumn(tupleID, col++, PSP->GetPosition().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,5, track->GetVertexPosition().x());
-    analysisManager->FillNtupleDColumn(tupleID,6, track->GetVertexPosition().y());
-    analysisManager->FillNtupleDColumn(tupleID,7, track->GetVertexPosition().z());
+    if (!fTrackHistory) { // otherwise in the TrackHistory tree
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().x());
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().y());
+        FillHitColumn(tupleID, col++, track->GetVertexPosition().z());
+    }
 
-    analysisManager->FillNtupleDColumn(tupleID,8, PSP->GetMomentumDirection().x());
-    analysisManager->FillNtupleDColumn(tupleID,9, PSP->GetMomentumDirection().y());
-    analysisManager->FillNtupleDColumn(tupleID,10, PSP->GetMomentumDirection().z());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().x());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().y());
+    FillHitColumn(tupleID, col++, PSP->GetMomentumDirection().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,11, track->GetPolarization().x());
-    analysisManager->FillNtupleDColumn(tupleID,12, track->GetPolarization().y());
-    analysisManager->FillNtupleDColumn(tupleID,13, track->GetPolarization().z());
+    FillHitColumn(tupleID, col++, track->GetPolarization().x());
+    FillHitColumn(tupleID, col++, track->GetPolarization().y());
+    FillHitColumn(tupleID, col++, track->GetPolarization().z());
 
-    analysisManager->FillNtupleDColumn(tupleID,14, track->GetTrackID());
-    analysisManager->FillNtupleDColumn(tupleID,15, track->GetParentID());
-    analysisManager->FillNtupleDColumn(tupleID,16, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    FillHitColumn(tupleID, col++, track->GetTrackID());
+    if (!fTrackHistory) {
+        FillHitColumn(tupleID, col++, track->GetParentID());
+    } else {
+        MarkTrack(track->GetTrackID());
+    }
+    FillHitColumn(tupleID, col++, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
 
-    analysisManager->FillNtupleIColumn(tupleID,17, history->GetReplicaNumber(motherdepth));
-    analysisManager->AddNtupleRow(tupleID);
+    FillHitColumn(tupleID, col++, history->GetReplicaNumber(motherdepth));
+    if (fWeightStatus) {
+        FillHitColumn(tupleID, col++, track->GetWeight());
+    }
+    AddHitRow(tupleID);
 };
 
-void AnaConfigManager::FillCaloCrystNtuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) const {
-    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+void AnaConfigManager::FillCaloCrystNtuple_detailed(int tupleID,const G4VTouchable* history, G4Step* step) {
     auto track = step->GetTrack();
     auto PSP = step->GetPostStepPoint();
-    analysisManager->FillNtupleIColumn(tupleID,0, track->GetParticleDefinition()->GetPDGEncoding());
-    analysisManager->FillNtupleDColumn(tupleID,1, PSP->GetTotalEnergy()/CLHEP::MeV);
-    analysisManager->FillNtupleDColumn(tupleID,2,step->GetTotalEnergyDeposit()/CLHEP::MeV);
-    analysisManager->FillNtupleDColumn(tupleID,3, PSP->GetPosition().x());
-    analysisManager->FillNtupleDColumn(tupleID,4, PSP->GetPosition().y());
-    analysisManager->FillNtupleDColumn(tupleID,5, PSP->GetPosition().z());
-    analysisManager->FillNtupleIColumn(tupleID,6, track->GetTrackID());
-    analysisManager->FillNtupleIColumn(tupleID,7, track->GetParentID());
-    analysisManager->FillNtupleIColumn(tupleID,8, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
-    analysisManager->FillNtupleIColumn(tupleID,9, history->GetReplicaNumber(3));
-    analysisManager->AddNtupleRow(tupleID);
+    FillHitColumn(tupleID, 0, track->GetParticleDefinition()->GetPDGEncoding());
+    FillHitColumn(tupleID, 1, PSP->GetTotalEnergy()/CLHEP::MeV);
+    FillHitColumn(tupleID, 2, step->GetTotalEnergyDeposit()/CLHEP::MeV);
+    FillHitColumn(tupleID, 3, PSP->GetPosition().x());
+    FillHitColumn(tupleID, 4, PSP->GetPosition().y());
+    FillHitColumn(tupleID, 5, PSP->GetPosition().z());
+    FillHitColumn(tupleID, 6, track->GetTrackID());
+    FillHitColumn(tupleID, 7, track->GetParentID());
+    FillHitColumn(tupleID, 8, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    FillHitColumn(tupleID, 9, history->GetReplicaNumber(fCrystalCellDepth));
+    if (fWeightStatus) {
+        FillHitColumn(tupleID, 10, step->GetPreStepPoint()->GetWeight());
+    }
+    AddHitRow(tupleID);
+    if (fTrackHistory) MarkTrack(track->GetTrackID());
 }
 
-void AnaConfigManager::FillBaseNtuple_summary(int tupleID,
-                                                const std::vector<int> particleCounts,
-                                                const std::vector<G4double> energySums) const {
+void AnaConfigManager::FillCaloCrystSegment(int tupleID, const CrystalSegment& segment) {
+    FillHitColumn(tupleID, 0, segment.pdg);
+    FillHitColumn(tupleID, 1, segment.E/CLHEP::MeV);
+    FillHitColumn(tupleID, 2, segment.Edep/CLHEP::MeV);
+    FillHitColumn(tupleID, 3, segment.Edep_ct/CLHEP::MeV);
+    FillHitColumn(tupleID, 4, segment.entry.x());
+    FillHitColumn(tupleID, 5, segment.entry.y());
+    FillHitColumn(tupleID, 6, segment.entry.z());
+    FillHitColumn(tupleID, 7, segment.exit.x());
+    FillHitColumn(tupleID, 8, segment.exit.y());
+    FillHitColumn(tupleID, 9, segment.exit.z());
+    FillHitColumn(tupleID, 10, segment.nSteps);
+    FillHitColumn(tupleID, 11, segment.trackID);
+    FillHitColumn(tupleID, 12, segment.parentID);
+    FillHitColumn(tupleID, 13, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    FillHitColumn(tupleID, 14, segment.crystNo);
+    if (fWeightStatus) {
+        FillHitColumn(tupleID, 15, segment.weight);
+    }
+    AddHitRow(tupleID);
+    if (fTrackHistory) MarkTrack(segment.trackID);
+};
+
+void AnaConfigManager::RegisterTrack(const G4Track* track) {
+    // track IDs start at 1 and are counted up within the event
+    std::size_t trackID = track->GetTrackID();
+    if (trackID >= fTrackRecords.size()) {
+        fTrackRecords.resize(trackID+1);
+    }
+    TrackRecord& record = fTrackRecords[trackID];
+    record.parentID = track->GetParentID();
+    record.pdg = track->GetParticleDefinition()->GetPDGEncoding();
+    record.vertex = track->GetVertexPosition();
+    record.Ekin = track->GetVertexKineticEnergy();
+    record.process = track->GetCreatorProcess() ? track->GetCreatorProcess()->GetProcessName() : "primary";
+    record.registered = true;
+    record.write = false;
+};
+
+void AnaConfigManager::MarkTrack(int trackID) {
+    if (trackID > 0 && trackID < (int)fTrackRecords.size()) {
+        fTrackRecords[trackID].write = true;
+    }
+};
+
+void AnaConfigManager::WriteTrackHistory(int eventID, bool keep) {
+    if (!keep) {
+        fTrackRecords.clear();
+        return;
+    }
+    // a daughter always has a larger ID than its parent, so one pass
+    // from the back marks all ancestors of the tracks with hits
+    for (std::size_t trackID = fTrackRecords.size(); trackID-- > 1; ) {
+        const TrackRecord& record = fTrackRecords[trackID];
+        if (record.write) MarkTrack(record.parentID);
+    }
+
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
-    analysisManager->FillNtupleDColumn(tupleID, 0, energySums[0]); // energySum
-    analysisManager->FillNtupleIColumn(tupleID, 1, particleCounts[0]); // Ntot
-    analysisManager->FillNtupleDColumn(tupleID, 2, energySums[1]);
-    analysisManager->FillNtupleIColumn(tupleID, 3, particleCounts[1]);
-    analysisManager->FillNtupleDColumn(tupleID, 4, energySums[2]);
-    analysisManager->FillNtupleIColumn(tupleID, 5, particleCounts[2]);
-    analysisManager->AddNtupleRow(tupleID);
+    for (std::size_t trackID = 1; trackID < fTrackRecords.size(); ++trackID) {
+        const TrackRecord& record = fTrackRecords[trackID];
+        if (!record.registered || !record.write) continue;
+        analysisManager->FillNtupleIColumn(fTrackHistoryTupleID, 0, eventID);
+        analysisManager->FillNtupleIColumn(fTrackHistoryTupleID, 1, trackID);
+        analysisManager->FillNtupleIColumn(fTrackHistoryTupleID, 2, record.parentID);
+        analysisManager->FillNtupleIColumn(fTrackHistoryTupleID, 3, record.pdg);
+        analysisManager->FillNtupleDColumn(fTrackHistoryTupleID, 4, record.vertex.x());
+        analysisManager->FillNtupleDColumn(fTrackHistoryTupleID, 5, record.vertex.y());
+        analysisManager->FillNtupleDColumn(fTrackHistoryTupleID, 6, record.vertex.z());
+        analysisManager->FillNtupleDColumn(fTrackHistoryTupleID, 7, record.Ekin/CLHEP::MeV);
+        analysisManager->FillNtupleSColumn(fTrackHistoryTupleID, 8, record.process);
+        analysisManager->AddNtupleRow(fTrackHistoryTupleID);
+    }
+    fTrackRecords.clear();
 };
 
-void AnaConfigManager::FillCaloFrontTuple_summary(int tupleID,
-                                                    const std::vector<int> NP,
-                                                    const std::vector<double> Esum) const {
+void AnaConfigManager::FillHitColumn(int tupleID, int column, G4double value) {
+    auto eventColumn = fHitEventColumn.find(tupleID);
+    if (eventColumn == fHitEventColumn.end() && fTriggerStatus) { // kept until the trigger decision
+        fHitRowBuffer[tupleID].push_back(value);
+        return;
+    }
+    if (eventColumn == fHitEventColumn.end()) { // one row per hit
+        G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+        if (fColumnTypes[tupleID][column] == "I") {
+            analysisManager->FillNtupleIColumn(tupleID, column, G4int(value));
+        } else {
+            analysisManager->FillNtupleDColumn(tupleID, column, value);
+        }
+        return;
+    }
+    // vector layout, the EventID is written once per event
+    if (column == eventColumn->second) return;
+    if (fColumnTypes[tupleID][column] == "I") {
+        fHitBufferI[tupleID][column].push_back(G4int(value));
+    } else {
+        fHitBufferF[tupleID][column].push_back(float(value));
+    }
+};
+
+void AnaConfigManager::AddHitRow(int tupleID) {
+    if (fHitEventColumn.find(tupleID) == fHitEventColumn.end() && !fTriggerStatus) {
+        G4AnalysisManager::Instance()->AddNtupleRow(tupleID);
+    }
+};
+
+void AnaConfigManager::WriteHitBuffers(int eventID, bool keep) {
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
-    for (int i = 0; i < 9; ++i) {
-        analysisManager->FillNtupleDColumn(tupleID, i, Esum[i]);
-        //G4cout << "Filling branch with value: " << Esum[i] << G4endl;
+    // row layout with trigger: the buffered rows of the event
+    for (auto& entry : fHitRowBuffer) {
+        int tupleID = entry.first;
+        auto& values = entry.second;
+        const auto& types = fColumnTypes[tupleID];
+        if (keep && !types.empty()) {
+            for (std::size_t i = 0; i + types.size() <= values.size(); i += types.size()) {
+                for (std::size_t j = 0; j < types.size(); ++j) {
+                    if (types[j] == "I") {
+                        analysisManager->FillNtupleIColumn(tupleID, j, G4int(values[i+j]));
+                    } else {
+                        analysisManager->FillNtupleDColumn(tupleID, j, values[i+j]);
+                    }
+                }
+                analysisManager->AddNtupleRow(tupleID);
+            }
+        }
+        values.clear();
     }
-    for (int i = 0; i < 9; ++i) {
-        analysisManager->FillNtupleDColumn(tupleID, 9+i, NP[i]);
+    for (const auto& entry : fHitEventColumn) {
+        int tupleID = entry.first;
+        auto& bufferF = fHitBufferF[tupleID];
+        auto& bufferI = fHitBufferI[tupleID];
+        // like in the row layout, events without hits are not written
+        G4bool empty = true;
+        for (const auto& values : bufferF) { if (!values.empty()) empty = false; }
+        for (const auto& values : bufferI) { if (!values.empty()) empty = false; }
+        if (empty) continue;
+        if (!keep) {
+            for (auto& values : bufferF) { values.clear(); }
+            for (auto& values : bufferI) { values.clear(); }
+            continue;
+        }
+
+        if (fColumnTypes[tupleID][entry.second] == "D") {
+            analysisManager->FillNtupleDColumn(tupleID, entry.second, eventID);
+        } else {
+            analysisManager->FillNtupleIColumn(tupleID, entry.second, eventID);
+        }
+        analysisManager->AddNtupleRow(tupleID);
+        for (auto& values : bufferF) { values.clear(); }
+        for (auto& values : bufferI) { values.clear(); }
     }
-    analysisManager->AddNtupleRow(tupleID);
+};
+
+void AnaConfigManager::FillBaseNtuple_summary(int tupleID,
+                                                const std::vector<G4double> particleCounts,
+                                                const std::vector<G4double> energySums) {
+    std::vector<G4double> row = {
+        energySums[0], particleCounts[0], // energySum, Ntot
+        energySums[1], particleCounts[1],
+        energySums[2], particleCounts[2]
+    };
+    AddSummaryRow(tupleID, row);
+};
+
+void AnaConfigManager::FillCaloFrontTuple_summary(int tupleID,
+                                                    const std::vector<double> NP,
+                                                    const std::vector<double> Esum) {
+    const std::size_t n = Esum.size();
+    std::vector<G4double> row(2*n);
+    for (std::size_t i = 0; i < n; ++i) {
+        row[i] = Esum[i];
+        row[n+i] = NP[i];
+    }
+    AddSummaryRow(tupleID, row);
 };
 
 
 void AnaConfigManager::FillCaloCrystNtuple_summary(int tupleID,
                                                     const std::vector<double> Edep,
-                                                    const std::vector<double> Edep_ct) const {
-    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
-    for (int i = 0; i < 9; ++i) {
-        analysisManager->FillNtupleDColumn(tupleID, i, Edep[i]);
+                                                    const std::vector<double> Edep_ct) {
+    const std::size_t n = Edep.size();
+    std::vector<G4double> row(2*n);
+    for (std::size_t i = 0; i < n; ++i) {
+        row[i] = Edep[i];
+        row[n+i] = Edep_ct[i];
     }
-    for (int i = 0; i < 9; ++i) {
-        analysisManager->FillNtupleDColumn(tupleID, 9+i, Edep_ct[i]);
-    }
-    analysisManager->AddNtupleRow(tupleID);
+    AddSummaryRow(tupleID, row);
 };
 
 
 void AnaConfigManager::FillHistos(int ID, G4Step* step)const{
+    // only the first detectors have spectra (see ReadHistoInfo), e.g. not behindCalo and the scoring planes
+    if (ID >= int(fHistoInfo.size())) return;
     G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
     auto PSP = step->GetPostStepPoint();
     auto ene = PSP->GetTotalEnergy()/CLHEP::MeV;
-    analysisManager->FillH1(ID,ene);
-    analysisManager->FillH2(ID, PSP->GetPosition().x(),PSP->GetPosition().y(),ene);
+    auto weight = step->GetTrack()->GetWeight();
+    analysisManager->FillH1(ID,ene,weight);
+    analysisManager->FillH2(ID, PSP->GetPosition().x(),PSP->GetPosition().y(),ene*weight);
+};
+
+void AnaConfigManager::SetCrystalGeometry(G4double crystXY, G4double crystThick, G4double cellXY, const std::vector<G4ThreeVector>& positions, int cellDepth) {
+    fCrystXY = crystXY;
+    fCrystThick = crystThick;
+    fCellXY = cellXY;
+    fCrystalPos = positions;
+    fCrystalCellDepth = cellDepth;
+};
+
+void AnaConfigManager::FillCaloCluster(const std::vector<double>& edep, G4double ein, G4double einX, G4double einY) {
+    // energy weighted centroid and second moments from the crystal centres
+    G4double etot = 0., sx = 0., sy = 0., sxx = 0., syy = 0., sxy = 0.;
+    std::size_t iMax = 0;
+    for (std::size_t i = 0; i < edep.size() && i < fCrystalPos.size(); ++i) {
+        G4double x = fCrystalPos[i].x();
+        G4double y = fCrystalPos[i].y();
+        etot += edep[i];
+        sx += edep[i]*x;
+        sy += edep[i]*y;
+        sxx += edep[i]*x*x;
+        syy += edep[i]*y*y;
+        sxy += edep[i]*x*y;
+        if (edep[i] > edep[iMax]) iMax = i;
+    }
+    G4double xc = 0., yc = 0., mxx = 0., myy = 0., mxy = 0.;
+    if (etot > 0) {
+        xc = sx/etot;
+        yc = sy/etot;
+        mxx = sxx/etot - xc*xc;
+        myy = syy/etot - yc*yc;
+        mxy = sxy/etot - xc*yc;
+    }
+
+    // energy in the 3x3 crystals around the one with the maximum
+    G4double e3x3 = 0.;
+    for (std::size_t i = 0; i < edep.size() && i < fCrystalPos.size(); ++i) {
+        if (std::abs(fCrystalPos[i].x() - fCrystalPos[iMax].x()) < 1.5*fCellXY &&
+            std::abs(fCrystalPos[i].y() - fCrystalPos[iMax].y()) < 1.5*fCellXY) {
+            e3x3 += edep[i];
+        }
+    }
+    G4double emax = edep.empty() ? 0. : edep[iMax];
+
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 0, etot/CLHEP::MeV);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 1, xc);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 2, yc);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 3, mxx);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 4, myy);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 5, mxy);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 6, emax/CLHEP::MeV);
+    analysisManager->FillNtupleIColumn(fClusterTupleID, 7, iMax);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 8, e3x3 > 0 ? emax/e3x3 : 0.);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 9, ein);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 10, ein > 0 ? einX/ein : 0.);
+    analysisManager->FillNtupleDColumn(fClusterTupleID, 11, ein > 0 ? einY/ein : 0.);
+    analysisManager->FillNtupleIColumn(fClusterTupleID, 12, G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID());
+    analysisManager->AddNtupleRow(fClusterTupleID);
+};
+
+void AnaConfigManager::BookShowerGrid() {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    int nx = fConfig.ReadIntOrDefault("Calorimeter", "showerBinsX", 10);
+    int ny = fConfig.ReadIntOrDefault("Calorimeter", "showerBinsY", 10);
+    int nz = fConfig.ReadIntOrDefault("Calorimeter", "showerBinsZ", 45);
+    int nr = fConfig.ReadIntOrDefault("Calorimeter", "showerBinsR", 50);
+    // one grid per crystal, the index is the copy number
+    fShowerGrid.Configure(fCrystalPos.size(), nx, ny, nz, fCrystXY/2., fCrystThick/2.);
+
+    // only the voxels with energy are written
+    fShowerTupleID = analysisManager->CreateNtuple("ShowerVoxels", "energy deposition per crystal voxel");
+    analysisManager->CreateNtupleIColumn(fShowerTupleID, "EventID"); // -1 for the sum of the run
+    analysisManager->CreateNtupleIColumn(fShowerTupleID, "crystNo");
+    analysisManager->CreateNtupleIColumn(fShowerTupleID, "ix");
+    analysisManager->CreateNtupleIColumn(fShowerTupleID, "iy");
+    analysisManager->CreateNtupleIColumn(fShowerTupleID, "iz");
+    analysisManager->CreateNtupleDColumn(fShowerTupleID, "Edep");
+    analysisManager->FinishNtuple(fShowerTupleID);
+
+    // profiles of the whole run, depth from the crystal front and radius from the calorimeter axis
+    G4double rMax = 0.;
+    for (const auto& position : fCrystalPos) {
+        rMax = std::max(rMax, position.perp() + fCellXY/std::sqrt(2.));
+    }
+    fShowerLongID = analysisManager->CreateH1("ShowerLong", "longitudinal shower profile;depth [mm];Edep [MeV]", nz, 0., fCrystThick);
+    fShowerRadialID = analysisManager->CreateH1("ShowerRadial", "radial shower profile;r [mm];Edep [MeV]", nr, 0., rMax);
+};
+
+void AnaConfigManager::FillShowerGrid(const G4VTouchable* history, G4Step* step) {
+    G4double edep = step->GetTotalEnergyDeposit()*step->GetPreStepPoint()->GetWeight()/CLHEP::MeV;
+    if (edep == 0) return;
+    G4ThreeVector position = 0.5*(step->GetPreStepPoint()->GetPosition() + step->GetPostStepPoint()->GetPosition());
+
+    // crystal at depth 0, the calorimeter mother volume one level above the cell
+    const G4NavigationHistory* navHistory = history->GetHistory();
+    G4ThreeVector local = navHistory->GetTopTransform().TransformPoint(position);
+    G4ThreeVector calo = navHistory->GetTransform(navHistory->GetDepth()-fCrystalCellDepth-1).TransformPoint(position);
+
+    fShowerGrid.Add(history->GetReplicaNumber(fCrystalCellDepth), local.x(), local.y(), local.z(), edep);
+
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    analysisManager->FillH1(fShowerLongID, local.z() + fCrystThick/2., edep);
+    analysisManager->FillH1(fShowerRadialID, calo.perp(), edep);
+};
+
+void AnaConfigManager::WriteShowerGrid(int eventID, bool keep) {
+    if (!keep) {
+        fShowerGrid.Reset();
+        return;
+    }
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    int cell, ix, iy, iz;
+    for (auto index : fShowerGrid.GetFilledBins()) {
+        fShowerGrid.GetBin(index, cell, ix, iy, iz);
+        analysisManager->FillNtupleIColumn(fShowerTupleID, 0, eventID);
+        analysisManager->FillNtupleIColumn(fShowerTupleID, 1, cell);
+        analysisManager->FillNtupleIColumn(fShowerTupleID, 2, ix);
+        analysisManager->FillNtupleIColumn(fShowerTupleID, 3, iy);
+        analysisManager->FillNtupleIColumn(fShowerTupleID, 4, iz);
+        analysisManager->FillNtupleDColumn(fShowerTupleID, 5, fShowerGrid.GetValue(index));
+        analysisManager->AddNtupleRow(fShowerTupleID);
+    }
+    fShowerGrid.Reset();
+};
+
+void AnaConfigManager::FillPairedTuple(int eventID, G4double edep, G4double ein) {
+    if (fPolState == 0) {
+        // first run of the pair: remember the event, the ID is the index
+        int index = eventID - fEventIDOffset;
+        if (index >= (int)fPairedReference.size()) {
+            fPairedReference.resize(index+1, std::make_pair(0., 0.));
+        }
+        fPairedReference[index] = std::make_pair(edep, ein);
+        return;
+    }
+    int index = eventID - fEventIDOffset;
+    if (index >= (int)fPairedReference.size()) return;
+
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    const auto& reference = fPairedReference[index];
+    analysisManager->FillNtupleIColumn(fPairedTupleID, 0, eventID);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 1, reference.first);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 2, edep);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 3, reference.first - edep);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 4, reference.second);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 5, ein);
+    analysisManager->FillNtupleDColumn(fPairedTupleID, 6, reference.second - ein);
+    analysisManager->AddNtupleRow(fPairedTupleID);
+};
+
+bool AnaConfigManager::AddAsymmetryEvent(G4double edep, G4double ein) {
+    // without front detector the transmission is just the mean Edep per event
+    fAsymEstimator.Add(fPolState, edep, fAsymUseFront ? ein : 1.);
+
+    long nEvents = fAsymEstimator.GetNEvents(fPolState);
+    if (fAsymPrecision <= 0 || !fAsymStopReason.empty() || nEvents % fAsymCheckEvery != 0) return false;
+
+    G4double error = 0;
+    if (fPolState == 0) {
+        // the asymmetry is not known yet, for small A its error is about
+        // sqrt(d0^2+d1^2)/2 with the relative ratio errors d -> split evenly
+        G4double ratio = fAsymEstimator.GetRatio(0, error);
+        if (ratio == 0 || error == 0 || error/ratio > std::sqrt(2.)*fAsymPrecision) return false;
+    } else {
+        fAsymEstimator.GetAsymmetry(error);
+        if (error == 0 || error > fAsymPrecision) return false;
+    }
+    G4cout << "----> Target precision reached after " << nEvents << " events -> run stopped" << G4endl;
+    fAsymStopReason = "precision";
+    return true;
+}
+
+void AnaConfigManager::EndOfRunAsymmetry(int nEvents) {
+    if (fAsymStopReason.empty() && fAsymPrecision <= 0) {
+        fAsymStopReason = "crossCheck";
+    } else if (fAsymStopReason.empty()) {
+        fAsymStopReason = nEvents >= fAsymMaxEvents ? "maxEvents" : "aborted";
+    }
+    G4double ratioError;
+    G4double ratio = fAsymEstimator.GetRatio(fPolState, ratioError);
+    AddRunMetadata("Result.stopReason", fAsymStopReason);
+    AddRunMetadata("Result.nEvents", std::to_string(nEvents));
+    AddRunMetadata("Result.ratio", std::to_string(ratio));
+    AddRunMetadata("Result.ratioError", std::to_string(ratioError));
+    if (fPolState == 1) {
+        G4double asymError;
+        G4double asym = fAsymEstimator.GetAsymmetry(asymError);
+        AddRunMetadata("Result.asymmetry", std::to_string(asym));
+        AddRunMetadata("Result.asymmetryError", std::to_string(asymError));
+        if (asym != 0) {
+            AddRunMetadata("Result.relPrecision", std::to_string(std::abs(asymError/asym)));
+        }
+        G4cout << "----> Asymmetry: " << asym << " +- " << asymError << " (" << fAsymStopReason << ")" << G4endl;
+        std::size_t point = fRunID/2;
+        if (point < fFastPredictions.size()) {
+            AddRunMetadata("Result.fastAsymmetry", std::to_string(fFastPredictions[point]));
+            G4cout << "----> Fast model asymmetry: " << fFastPredictions[point] << G4endl;
+        }
+    }
+};
+
+void AnaConfigManager::BeginOfEventAbort() {
+    fAbortReason = "";
+    fEventCrossings.clear();
+    fEventEnergy.clear();
+    fEventCrystEdep.clear();
+    fEventStartClock = std::clock();
+};
+
+void AnaConfigManager::RequestAbort(const std::string& reason) {
+    if (!fAbortReason.empty()) return;
+    fAbortReason = reason;
+    G4cout << "Event aborted: " << reason << G4endl;
+    G4RunManager::GetRunManager()->AbortEvent();
+};
+
+void AnaConfigManager::CountCrossing(int tupleID, G4double energy, bool energyLimit) {
+    if (!fAbortStatus) return;
+    int crossings = ++fEventCrossings[tupleID];
+    if (fAbortMaxCrossings > 0 && crossings >= fAbortMaxCrossings) {
+        RequestAbort("maxCrossings");
+    }
+    if (energyLimit && fEinLim != 0.) {
+        G4double ein = fEventEnergy[tupleID] += energy;
+        if (ein >= fEinLim) {
+            RequestAbort("EinLimit");
+        }
+    }
+};
+
+void AnaConfigManager::CheckCrystalEdep(int crystNo, G4double edep) {
+    if (fAbortCrystEdep <= 0) return;
+    if ((fEventCrystEdep[crystNo] += edep) >= fAbortCrystEdep) {
+        RequestAbort("crystSaturation");
+    }
+};
+
+void AnaConfigManager::CheckCpuBudget() {
+    if (fAbortCpuBudget > 0 && G4double(std::clock() - fEventStartClock)/CLOCKS_PER_SEC > fAbortCpuBudget) {
+        RequestAbort("cpuBudget");
+    }
+};
+
+void AnaConfigManager::EndOfEventAbort(int eventID) {
+    if (fAbortReason.empty()) return;
+    fAbortCounts[fAbortReason] += 1;
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    analysisManager->FillNtupleIColumn(fAbortTupleID, 0, eventID);
+    analysisManager->FillNtupleSColumn(fAbortTupleID, 1, fAbortReason);
+    analysisManager->AddNtupleRow(fAbortTupleID);
+};
+
+void AnaConfigManager::EndOfRunAbort() {
+    long total = 0;
+    for (const auto& entry : fAbortCounts) {
+        AddRunMetadata("Result.aborted_" + entry.first, std::to_string(entry.second));
+        total += entry.second;
+    }
+    AddRunMetadata("Result.abortedEvents", std::to_string(total));
+};
+
+bool AnaConfigManager::ApplyTrigger(G4double edep, G4double ein) {
+    fTrigEvents += 1;
+    bool accepted = edep >= fTrigEdepMin && (!fTrigFrontHit || ein > 0);
+    if (accepted) fTrigAccepted += 1;
+    return accepted;
+};
+
+void AnaConfigManager::EndOfRunTrigger() {
+    AddRunMetadata("Result.triggerEvents", std::to_string(fTrigEvents));
+    AddRunMetadata("Result.triggerAccepted", std::to_string(fTrigAccepted));
+    G4double efficiency = fTrigEvents > 0 ? G4double(fTrigAccepted)/fTrigEvents : 0.;
+    AddRunMetadata("Result.triggerEfficiency", std::to_string(efficiency));
+};
+
+void AnaConfigManager::EndOfRunSparse(int nEvents) {
+    // with the number of events the skipped rows can be restored as zeros
+    AddRunMetadata("Result.nEvents", std::to_string(nEvents));
+    for (const auto& treeInfo : fTreesInfo) {
+        auto it = fSkippedRows.find(treeInfo.id);
+        long skipped = it != fSkippedRows.end() ? it->second : 0;
+        AddRunMetadata("Result.skippedEvents_" + treeInfo.name, std::to_string(skipped));
+    }
+};
+
+void AnaConfigManager::AddResponseEvent(const std::vector<double>& edep, G4double ein) {
+    // columns: Ein, Edep summed over the crystals, Edep per crystal, all in MeV
+    std::vector<double> row(2 + edep.size());
+    row[0] = ein/CLHEP::MeV;
+    for (std::size_t i = 0; i < edep.size(); ++i) {
+        row[1] += edep[i]/CLHEP::MeV;
+        row[2 + i] = edep[i]/CLHEP::MeV;
+    }
+    fResponseStats.Add(row);
+    for (std::size_t c = 0; c < row.size(); ++c) {
+        int bin = fResponseHistMax > 0 ? int(row[c]/fResponseHistMax*fResponseNBins) : 0;
+        // overflow goes to the last bin
+        bin = std::min(std::max(bin, 0), fResponseNBins - 1);
+        fResponseHist[c*fResponseNBins + bin] += 1;
+    }
+};
+
+void AnaConfigManager::EndOfRunResponse() {
+    // run 2k is energy k with positive polarization, run 2k+1 the same with negative
+    std::size_t index = fRunID/2;
+    if (index >= fResponseEnergies.size()) {
+        G4cout << "Run " << fRunID << " is not part of the response energy grid, not added" << G4endl;
+        return;
+    }
+    ResponsePoint point;
+    point.energy = fResponseEnergies[index];
+    point.polSign = fPolState == 0 ? 1 : -1;
+    point.nEvents = fResponseStats.GetN();
+    for (std::size_t c = 0; c < fResponseStats.GetNColumns(); ++c) {
+        point.mean.push_back(fResponseStats.GetMean(c));
+        point.variance.push_back(fResponseStats.GetVariance(c));
+    }
+    point.hist = fResponseHist;
+    if (point.nEvents > 0) {
+        for (auto& value : point.hist) value /= point.nEvents;
+    }
+    fResponse.AddPoint(point);
+
+    // the file is rewritten after every run, so an interrupted scan keeps its points
+    std::string fileName = "response_" + fOutputFileName + ".txt";
+    fResponse.Write(fileName);
+    AddRunMetadata("Result.responseEnergy", std::to_string(point.energy));
+    AddRunMetadata("Result.responsePolSign", std::to_string(point.polSign));
+    AddRunMetadata("Result.responseFile", fileName);
+};
+
+void AnaConfigManager::AddWeightedEvent(G4double edep, G4double ein) {
+    fFomStats.Add({edep/CLHEP::MeV, ein/CLHEP::MeV});
+};
+
+void AnaConfigManager::EndOfRunFigureOfMerit() {
+    // FOM = 1/(relative error of the mean^2 * CPU time), comparable between biased and analog runs
+    G4double cpuTime = G4double(std::clock() - fRunStartClock)/CLOCKS_PER_SEC;
+    AddRunMetadata("Result.cpuTime", std::to_string(cpuTime));
+    const std::vector<std::string> names = {"Edep", "Ein"};
+    long n = fFomStats.GetN();
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        G4double mean = fFomStats.GetMean(i);
+        G4double variance = fFomStats.GetVariance(i);
+        AddRunMetadata("Result." + names[i] + "Mean", std::to_string(mean));
+        AddRunMetadata("Result." + names[i] + "Variance", std::to_string(variance));
+        if (n == 0 || mean == 0) continue;
+        G4double relError = std::sqrt(variance/n)/std::abs(mean);
+        AddRunMetadata("Result." + names[i] + "RelError", std::to_string(relError));
+        if (relError > 0 && cpuTime > 0) {
+            G4double fom = 1./(relError*relError*cpuTime);
+            AddRunMetadata("Result." + names[i] + "FOM", std::to_string(fom));
+            G4cout << "----> " << names[i] << ": relative error " << relError << ", figure of merit " << fom << " 1/s" << G4endl;
+        }
+    }
+};
+
+void AnaConfigManager::BeginOfEventStacking() {
+    fStackPeakDepth = 0;
+    fStackedTracks.assign(fStackClasses.size(), 0);
+    fKilledTracks.assign(fStackClasses.size(), 0);
+    fKilledEnergy.assign(fStackClasses.size(), 0.);
+};
+
+void AnaConfigManager::CountStackedTrack(int stackClass, long depth) {
+    fStackedTracks[stackClass] += 1;
+    if (depth > fStackPeakDepth) fStackPeakDepth = depth;
+};
+
+void AnaConfigManager::CountKilledTrack(int stackClass, G4double energy) {
+    // the kinetic energy (times the weight) which is missing in the detector sums
+    fKilledTracks[stackClass] += 1;
+    fKilledEnergy[stackClass] += energy;
+};
+
+void AnaConfigManager::EndOfEventStacking(int eventID) {
+    // a stacked track is a G4Track with its G4DynamicParticle plus the stack entry
+    G4double trackBytes = sizeof(G4Track) + sizeof(G4DynamicParticle) + sizeof(G4StackedTrack);
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    analysisManager->FillNtupleIColumn(fStackTupleID, 0, eventID);
+    analysisManager->FillNtupleIColumn(fStackTupleID, 1, fStackPeakDepth);
+    analysisManager->FillNtupleDColumn(fStackTupleID, 2, fStackPeakDepth*trackBytes/1024.);
+    for (std::size_t i = 0; i < fStackClasses.size(); ++i) {
+        analysisManager->FillNtupleIColumn(fStackTupleID, 3 + 3*i, fStackedTracks[i]);
+        analysisManager->FillNtupleIColumn(fStackTupleID, 4 + 3*i, fKilledTracks[i]);
+        analysisManager->FillNtupleDColumn(fStackTupleID, 5 + 3*i, fKilledEnergy[i]/CLHEP::MeV);
+        fRunKilledTracks[i] += fKilledTracks[i];
+        fRunKilledEnergy[i] += fKilledEnergy[i];
+    }
+    analysisManager->AddNtupleRow(fStackTupleID);
+    if (fStackPeakDepth > fStackRunPeakDepth) fStackRunPeakDepth = fStackPeakDepth;
+};
+
+void AnaConfigManager::EndOfRunStacking() {
+    G4double trackBytes = sizeof(G4Track) + sizeof(G4DynamicParticle) + sizeof(G4StackedTrack);
+    AddRunMetadata("Result.stackPeakDepth", std::to_string(fStackRunPeakDepth));
+    AddRunMetadata("Result.stackPeakMemory", std::to_string(fStackRunPeakDepth*trackBytes/1024.));
+    for (std::size_t i = 0; i < fStackClasses.size(); ++i) {
+        AddRunMetadata("Result.stackKilled_" + fStackClasses[i].name, std::to_string(fRunKilledTracks[i]));
+        AddRunMetadata("Result.stackKilledEnergy_" + fStackClasses[i].name, std::to_string(fRunKilledEnergy[i]/CLHEP::MeV));
+    }
+    G4cout << "----> Peak stack depth " << fStackRunPeakDepth << " tracks (" << fStackRunPeakDepth*trackBytes/1024. << " kB)" << G4endl;
+};
+
+void AnaConfigManager::AddRunMetadata(const std::string& key, const std::string& value) {
+    // a key is only written once, later values replace earlier ones
+    for (auto& kv : fRunMetadata) {
+        if (kv.first == key) {
+            kv.second = value;
+            return;
+        }
+    }
+    fRunMetadata.push_back(std::make_pair(key, value));
+};
+
+void AnaConfigManager::AddJobMetadata(const std::string& key, const std::string& value) {
+    fJobMetadata.push_back(std::make_pair(key, value));
 };
 
 void AnaConfigManager::SetupMetadataTTree() {
@@ -314,4 +1231,17 @@ void AnaConfigManager::SetupMetadataTTree() {
         }
     }
 
+    // results of this run, the keys use the section name Result
+    for (const auto& kv : fRunMetadata) {
+        analysisManager->FillNtupleSColumn(tupleID, keyColumnId, kv.first);
+        analysisManager->FillNtupleSColumn(tupleID, valueColumnId, kv.second);
+        analysisManager->AddNtupleRow(tupleID);
+    }
+    // worker of a split production, the keys use the section name Job
+    for (const auto& kv : fJobMetadata) {
+        analysisManager->FillNtupleSColumn(tupleID, keyColumnId, kv.first);
+        analysisManager->FillNtupleSColumn(tupleID, valueColumnId, kv.second);
+        analysisManager->AddNtupleRow(tupleID);
+    }
+
 }
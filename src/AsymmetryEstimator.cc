@@ -0,0 +1,55 @@
+#include "AsymmetryEstimator.hh"
+
+#include <cmath>
+
+AsymmetryEstimator::AsymmetryEstimator()
+    : fStats{RunningStats(2), RunningStats(2)},
+      fRow(2) {}
+
+AsymmetryEstimator::~AsymmetryEstimator() {}
+
+void AsymmetryEstimator::Reset() {
+    ResetState(0);
+    ResetState(1);
+}
+
+void AsymmetryEstimator::ResetState(int state) {
+    fStats[state].Reset();
+}
+
+void AsymmetryEstimator::Add(int state, double x, double y) {
+    fRow[0] = x;
+    fRow[1] = y;
+    fStats[state].Add(fRow);
+}
+
+double AsymmetryEstimator::GetRatio(int state, double& error) const {
+    const RunningStats& stats = fStats[state];
+    error = 0.;
+    if (stats.GetN() < 2 || stats.GetMean(1) == 0.) return 0.;
+
+    double n = stats.GetN();
+    double mx = stats.GetMean(0);
+    double my = stats.GetMean(1);
+    double vx = stats.GetVariance(0);
+    double vy = stats.GetVariance(1);
+    double cxy = stats.GetCovariance(0, 1);
+
+    double ratio = mx/my;
+    double var = (vx - 2*ratio*cxy + ratio*ratio*vy)/(n*my*my);
+    error = var > 0. ? std::sqrt(var) : 0.;
+    return ratio;
+}
+
+double AsymmetryEstimator::GetAsymmetry(double& error) const {
+    double e0, e1;
+    double r0 = GetRatio(0, e0);
+    double r1 = GetRatio(1, e1);
+    error = 0.;
+    double sum = r0 + r1;
+    if (sum == 0.) return 0.;
+
+    // dA/dR0 = 2 R1/(R0+R1)^2 and dA/dR1 = -2 R0/(R0+R1)^2
+    error = 2./(sum*sum)*std::sqrt(r1*r1*e0*e0 + r0*r0*e1*e1);
+    return (r0 - r1)/sum;
+}
@@ -4,12 +4,15 @@
 
 #include "G4RunManager.hh"
 
-BaseSensitiveDetector::BaseSensitiveDetector(const G4String& name, const std::string& layerIdentifier, int tupleID, AnaConfigManager& anaConfigManager)
+BaseSensitiveDetector::BaseSensitiveDetector(const G4String& name, const std::string& layerIdentifier, int tupleID, AnaConfigManager& anaConfigManager,
+                                             G4bool boundaryOnly, const G4ThreeVector& normal)
     : G4VSensitiveDetector(name),
       fLayerIdentifier(layerIdentifier),
       fTupleID(tupleID),
       fAnaConfigManager(anaConfigManager),
-      fOutputMode(anaConfigManager.GetOutputMode())
+      fOutputMode(anaConfigManager.GetOutputMode()),
+      fBoundaryOnly(boundaryOnly),
+      fNormal(normal)
 
 {
     //constructor body
@@ -20,27 +23,35 @@ BaseSensitiveDetector::~BaseSensitiveDetector() {}
 G4bool BaseSensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory* history) {
     
     
+    // crossing of a scoring plane: the step starting on its boundary
+    if (fBoundaryOnly && step->GetPreStepPoint()->GetStepStatus() != fGeomBoundary) {
+        return false;
+    }
+
     // Common data processing logic, using layerIdentifier for differentiation
-    if (step->GetPostStepPoint()->GetMomentumDirection().z() > 0){
+    if (step->GetPostStepPoint()->GetMomentumDirection().dot(fNormal) > 0){
         // No matter what the output format, always fill the histograms !  
         fAnaConfigManager.FillHistos(fTupleID,step);
+        fAnaConfigManager.CountCrossing(fTupleID, step->GetPostStepPoint()->GetTotalEnergy()/MeV, false);
 
         if (fOutputMode == "detailed") {
             fAnaConfigManager.FillBaseNtuple_detailed(fTupleID, step);
         } else { // outputmode == summary as default 
             // Get the PDG-ID to check what type of particle it is 
             int pID = step->GetTrack()->GetParticleDefinition()->GetPDGEncoding();
-            G4double ene = step->GetPostStepPoint()->GetTotalEnergy()/MeV;
+            // the energy sums and the counts are weighted with the track weight of biased runs
+            G4double weight = step->GetTrack()->GetWeight();
+            G4double ene = step->GetPostStepPoint()->GetTotalEnergy()/MeV*weight;
             // always add to total energy sum and total number of particles 
             fEnergySum += ene;
-            fNtot += 1; 
+            fNtot += weight; 
             //then add to respective particle sums 
             if (pID == 22){
                 fEgammaSum += ene;
-                fNgamma += 1;
+                fNgamma += weight;
             } else if (pID == 11){
                 fEeSum += ene;
-                fNe += 1;
+                fNe += weight;
             };
         }
     } 
@@ -0,0 +1,20 @@
+// CaloCellParameterisation.cc
+#include "CaloCellParameterisation.hh"
+
+#include "G4VPhysicalVolume.hh"
+
+CaloCellParameterisation::CaloCellParameterisation(G4int nX, G4int nY, G4double pitch, G4double zPos)
+  : fNX(nX), fNY(nY), fPitch(pitch), fZPos(zPos) {}
+
+CaloCellParameterisation::~CaloCellParameterisation() {}
+
+void CaloCellParameterisation::ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const {
+    physVol->SetTranslation(GetCellPosition(copyNo));
+    physVol->SetRotation(nullptr);
+}
+
+G4ThreeVector CaloCellParameterisation::GetCellPosition(G4int copyNo) const {
+    G4int row = copyNo / fNX;
+    G4int column = copyNo % fNX;
+    return G4ThreeVector((column - 0.5*(fNX-1))*fPitch, (0.5*(fNY-1) - row)*fPitch, fZPos);
+}
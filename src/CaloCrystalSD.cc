@@ -11,8 +11,8 @@ CaloCrystalSD::CaloCrystalSD(const G4String& name, const std::string& layerIdent
       fTupleID(tupleID),
       fAnaConfigManager(anaConfigManager),
       fShowerDevStat(anaConfigManager.GetShowerDevStat()),
-      fEdepTot(9),
-      fEdepTot_ct(9)
+      fEdepTot(anaConfigManager.GetNCrystals()),
+      fEdepTot_ct(anaConfigManager.GetNCrystals())
 
 {
     //constructor body
@@ -26,24 +26,56 @@ G4bool CaloCrystalSD::ProcessHits(G4Step* step, G4TouchableHistory* history) {
     // G4cout << " Edep in this step " << step->GetTotalEnergyDeposit()<< G4endl;
     // G4cout << "Lenght of the step" << step->GetStepLength()<< G4endl;
     // G4cout << "name of the prestepvolume"<< step->GetPreStepPoint()->GetTouchableHandle()->GetVolume()->GetName()<< G4endl;
-    if (fShowerDevStat) {
+    if (fShowerDevStat == 1) {
         fAnaConfigManager.FillCaloCrystNtuple_detailed(fTupleID, touchable, step);
-    } else { // outputmode == summary as default 
-        int crystNo = touchable->GetReplicaNumber(3);
+    }
+    // the sums are also needed for the per event quantities with the per step output
+    if (fAnaConfigManager.NeedsCrystalSums()) {
+        if (fShowerDevStat == 2) { // voxel grid next to the sums
+            fAnaConfigManager.FillShowerGrid(touchable, step);
+        }
+        int crystNo = touchable->GetReplicaNumber(fAnaConfigManager.GetCrystalCellDepth());
+        // weight of the track during this step, 1 without biasing
+        G4double weight = step->GetPreStepPoint()->GetWeight();
+        G4double Edep_ct = 0.;
         // Here the energy cherenkov threshold will be considered 
         if(step->GetTrack()->GetDefinition()->GetPDGCharge() != 0){ 
             G4double Etot = step->GetTrack()->GetTotalEnergy();
             if(Etot > 0.64243){
                 //G4cout << " Etot in this step " << Etot << G4endl;
                 // G4double Tlength = step->GetStepLength(); this is for trecklenght 
-                G4double Edep_ct = step->GetTotalEnergyDeposit();
+                Edep_ct = step->GetTotalEnergyDeposit()*weight;
                 fEdepTot_ct[crystNo] += Edep_ct;
             }
         }
         // always add to total energy sum and total number of particles 
-        G4double Edep = step->GetTotalEnergyDeposit();
+        G4double Edep = step->GetTotalEnergyDeposit()*weight;
         fEdepTot[crystNo] += Edep;
-        
+        fAnaConfigManager.CheckCrystalEdep(crystNo, Edep);
+
+        if (fShowerDevStat == 3) { // track segments
+            auto track = step->GetTrack();
+            // a new weight (splitting, forced interaction) starts a new segment
+            if (track->GetTrackID() != fSegment.trackID || crystNo != fSegment.crystNo || weight != fSegment.weight) {
+                FlushSegment();
+                fSegment.trackID = track->GetTrackID();
+                fSegment.parentID = track->GetParentID();
+                fSegment.pdg = track->GetParticleDefinition()->GetPDGEncoding();
+                fSegment.crystNo = crystNo;
+                fSegment.E = step->GetPreStepPoint()->GetTotalEnergy();
+                fSegment.entry = step->GetPreStepPoint()->GetPosition();
+                fSegment.weight = weight;
+            }
+            fSegment.exit = step->GetPostStepPoint()->GetPosition();
+            // unweighted, the weight is a column of the row
+            fSegment.Edep += step->GetTotalEnergyDeposit();
+            fSegment.Edep_ct += Edep_ct > 0 ? step->GetTotalEnergyDeposit() : 0.;
+            fSegment.nSteps += 1;
+            // the track leaves the crystal or stops
+            if (step->GetPostStepPoint()->GetStepStatus() == fGeomBoundary || track->GetTrackStatus() != fAlive) {
+                FlushSegment();
+            }
+        }
     }
 
     return true;
@@ -53,3 +85,10 @@ void CaloCrystalSD::Reset() {
     std::fill(fEdepTot.begin(),fEdepTot.end(),0.0);
     std::fill(fEdepTot_ct.begin(),fEdepTot_ct.end(),0.0);
 }
+
+void CaloCrystalSD::FlushSegment() {
+    if (fSegment.nSteps > 0) {
+        fAnaConfigManager.FillCaloCrystSegment(fTupleID, fSegment);
+    }
+    fSegment = CrystalSegment();
+}
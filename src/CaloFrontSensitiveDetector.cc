@@ -3,6 +3,7 @@
 #include "G4SystemOfUnits.hh"
 
 #include "G4RunManager.hh"
+#include "G4NavigationHistory.hh"
 
 
 CaloFrontSensitiveDetector::CaloFrontSensitiveDetector(const G4String& name, const std::string& layerIdentifier, int tupleID, AnaConfigManager& anaConfigManager, const G4double frontZPos)
@@ -11,10 +12,8 @@ CaloFrontSensitiveDetector::CaloFrontSensitiveDetector(const G4String& name, con
       fTupleID(tupleID),
       fAnaConfigManager(anaConfigManager),
       fOutputMode(anaConfigManager.GetOutputMode()),
-      fEinLim(anaConfigManager.GetEinLim()),
-      fEnergySum(9),
-      fNtot(9),
-      fEin_tot(0.),
+      fEnergySum(anaConfigManager.GetNCrystals()),
+      fNtot(anaConfigManager.GetNCrystals()),
       ffrontZPos(frontZPos)
 
 {
@@ -44,22 +43,16 @@ G4bool CaloFrontSensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*
         // No matter what the output format, always fill the histograms !  
         fAnaConfigManager.FillHistos(fTupleID,step);
 
-        // definde the if condition to check the total energy is reached.
+        // counts the particle and its energy, the event is aborted once EinLimit or maxCrossings is reached
         G4double Estep = step->GetPostStepPoint()->GetTotalEnergy()/MeV;
-        fEin_tot += Estep;
-        // G4cout << "ElLimit: " << fEinLim<< G4endl;
-        // G4cout << "Ein_total" << fEin_tot<< G4endl;
-        if (fEinLim != 0.) {
-            if (fEin_tot >= fEinLim){
-                G4cout << "Total Energy of " << fEin_tot << " MeV has been reached -> event stopped" << G4endl;
-                G4RunManager::GetRunManager()->AbortEvent();
-            }
-        }
+        fAnaConfigManager.CountCrossing(fTupleID, Estep, true);
 
         if (fOutputMode == "detailed") {
             auto touchable = preStepPoint->GetTouchable();
             fAnaConfigManager.FillCaloFrontTuple_detailed(fTupleID, touchable, step);
-        } else { // outputmode == summary as default 
+        }
+        // the sums are also needed for the per event quantities in detailed mode
+        if (fAnaConfigManager.NeedsFrontSums()) {
             auto touchable = preStepPoint->GetTouchable();
             int motherdepth = 1; 
             if (preStepPoint->GetPhysicalVolume()->GetName() == "VacStep4") {
@@ -67,12 +60,18 @@ G4bool CaloFrontSensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*
             }
             int crystNo = touchable->GetReplicaNumber(motherdepth);
             // G4cout << "ProcessHits called for volume: " << step->GetPreStepPoint()->GetPhysicalVolume()->GetName() << motherdepth << crystNo << G4endl;
-            G4double ene = step->GetPostStepPoint()->GetTotalEnergy()/MeV;
+            // weighted with the track weight of biased runs, also the counts
+            G4double ene = step->GetPostStepPoint()->GetTotalEnergy()/MeV*step->GetTrack()->GetWeight();
             // always add to total energy sum and total number of particles 
             //G4cout << fEnergySum[crystNo] << "+=" << ene << G4endl;
             fEnergySum[crystNo] += ene;
+            // energy weighted position in the calorimeter mother volume (2 levels up)
+            const G4NavigationHistory* navHistory = touchable->GetHistory();
+            G4ThreeVector caloPos = navHistory->GetTransform(navHistory->GetDepth()-2).TransformPoint(step->GetPostStepPoint()->GetPosition());
+            fEnergyX += ene*caloPos.x();
+            fEnergyY += ene*caloPos.y();
             
-            fNtot[crystNo] += 1; 
+            fNtot[crystNo] += step->GetTrack()->GetWeight(); 
         }
     } 
     
@@ -82,6 +81,7 @@ G4bool CaloFrontSensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*
 
 void CaloFrontSensitiveDetector::Reset() {
     std::fill(fEnergySum.begin(),fEnergySum.end(),0.0);
-    std::fill(fNtot.begin(),fNtot.end(),0); 
-    fEin_tot = 0.;
+    std::fill(fNtot.begin(),fNtot.end(),0.0); 
+    fEnergyX = 0.;
+    fEnergyY = 0.;
 }
\ No newline at end of file
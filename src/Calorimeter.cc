@@ -13,6 +13,8 @@
 #include "G4SubtractionSolid.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVParameterised.hh"
+#include "CaloCellParameterisation.hh"
 #include "G4SystemOfUnits.hh"
 
 #include "G4Exception.hh"
@@ -28,13 +30,14 @@ Calorimeter::Calorimeter(const ConfigReader& config, AnaConfigManager& anaConfig
   : fConfig(config), fAnaConfigManager(anaConfigManager) {
     // Read configuration values and initialize the subdetector
     fType = config.GetConfigValue("Calorimeter", "type");
-    if (fType != "full"){
-        fNcrystals = config.GetConfigValueAsInt("Calorimeter", "nCrystals");
-    } else {
-        fNcrystals = 9;
-    }
+    // N x M crystal matrix, nCrystals = 1 or 9 is still understood, "full" is always 3x3
+    fNcrystX = config.ReadNCrystalsX();
+    fNcrystY = config.ReadNCrystalsY();
     fCaloMat = config.GetConfigValue("Calorimeter","caloMaterial");
     fWorldMaterial = config.GetConfigValue("World", "material");
+    fDetailLevel = config.ReadDetailLevel();
+    fLogicFrontDet = nullptr;
+    fLogicBackDet = nullptr;
 
 }
 
@@ -65,6 +68,7 @@ G4LogicalVolume* Calorimeter::ConstructCalo() {
     //defining the size of the Calorimetercell and the virtual calorimeter (mother volume of the calorimetercells)
     //G4int NbofCalor = 9; //here later free parameter to select number of crystals
     G4double calorcellxy = aluwrapxy;
+
     G4double calorcelllength = aluwraplength + 2*detThick;
 
     G4double virtcalorxy;
@@ -80,15 +84,9 @@ G4LogicalVolume* Calorimeter::ConstructCalo() {
     }
     else{
       fVirtCaloLength = calorcelllength;
-      if (fNcrystals == 1){
-        virtcalorxy = calorcellxy;
-      }
-      else if (fNcrystals == 9){
-        virtcalorxy = 3*calorcellxy;
-      }
-      else {
-        virtcalorxy = calorcellxy;
-        G4String description = "You have chosen an invalid number of crystals! N needs to be either 1 or 9.";
+      virtcalorxy = calorcellxy;
+      if (fNcrystX < 1 || fNcrystY < 1){
+        G4String description = "You have chosen an invalid number of crystals! nCrystals needs to be either 1 or 9, nCrystalsX and nCrystalsY need to be at least 1.";
         G4Exception("Construct", "InvalidNumberOfCrystals", FatalException, description);
       }
     }
@@ -107,9 +105,13 @@ G4LogicalVolume* Calorimeter::ConstructCalo() {
   // mother volume of the whole calorimeter
   //---------------------------------------------------------------
 
+  // the housing of the full calorimeter sets the size, otherwise the crystal matrix
+  G4double virtcalorx = fType == "full" ? virtcalorxy : fNcrystX*calorcellxy;
+  G4double virtcalory = fType == "full" ? virtcalorxy : fNcrystY*calorcellxy;
+
   G4Box* solidCaloMother = new G4Box("solidCaloMother",  //Name
-                                virtcalorxy/2.,   // x size
-                                virtcalorxy/2.,     // y size
+                                virtcalorx/2.,   // x size
+                                virtcalory/2.,     // y size
                                 fVirtCaloLength/2.); // z size
 
   G4LogicalVolume* logicCaloMother = new G4LogicalVolume(solidCaloMother,    //its solid
@@ -140,101 +142,109 @@ G4LogicalVolume* Calorimeter::ConstructCalo() {
   if(fType=="full"){calocellZpos=-tbPlateZ/2+frontPlateZ+9*mm+calorcelllength/2+1*mm;}
   else{calocellZpos=0;}
 
-  if(fNcrystals==9){
-    //the array for the placement of the 9 calorimetercells in the virtual calorimeter
-    G4double CalorRX[9]={-calorcellxy, 0, calorcellxy,-calorcellxy, 0, calorcellxy, -calorcellxy, 0, calorcellxy};
-    G4double CalorRY[9]={calorcellxy,calorcellxy,calorcellxy, 0,0,0,-calorcellxy,-calorcellxy,-calorcellxy};
-
-    for (G4int i=0;i<=8;i++){
-      new G4PVPlacement(0,		       //no rotation
-                        G4ThreeVector(CalorRX[i],CalorRY[i],calocellZpos),  //its position
+  // all cells are placed by one parameterised volume, copy number = row*nCrystalsX + column
+  // with row 0 at the top (+y) and column 0 on the left (-x), as the former 3x3 placement
+  auto cellParam = new CaloCellParameterisation(fNcrystX, fNcrystY, calorcellxy, calocellZpos);
+  new G4PVParameterised("physCaloCell",    //its name
                         logicCaloCell,            //its logical volume
-                        "physCaloCell",    //its name
                         logicCaloMother,               //its mother
-                        false,                     //no boolean operat
-                        i,                              //copy number       //copy number
-                        true);                     // check overlap    
-      }
-  } else if (fNcrystals == 1){
-    new G4PVPlacement(0,		       //no rotation
-                      G4ThreeVector(0,0,calocellZpos),  //its position
-                      logicCaloCell,            //its logical volume
-                      "physCaloCell",    //its name
-                      logicCaloMother,               //its mother
-                      false,                     //no boolean operat
-                      0);                        //copy number       //copy number
+                        kUndefined,                //let the navigation choose the voxelisation axis
+                        fNcrystX*fNcrystY,         //number of cells
+                        cellParam,                 //the parameterisation
+                        true);                     // check overlap
+
+  // cell positions in the calorimeter mother volume, index is the copy number
+  std::vector<G4ThreeVector> crystalPositions;
+  for (G4int i = 0; i < fNcrystX*fNcrystY; i++){
+    crystalPositions.push_back(cellParam->GetCellPosition(i));
   }
 
   logicCaloCell->SetVisAttributes(G4VisAttributes::GetInvisible());
 
+  // the crystal layout is needed for the shower development and the clustering
+  fAnaConfigManager.SetCrystalGeometry(crystXY, crystThick, calorcellxy, crystalPositions, fDetailLevel == "full" ? 3 : 1);
+
   //---------------------------------------------------------------
-  // reflective aluminium wrapping  
+  // crystal, here lead glass   
   //---------------------------------------------------------------
+  auto solidCrystal = new G4Box("solidCrystal",  //Name
+                                 crystXY/2.,   // x size
+                                 crystXY/2.,     // y size
+                                 crystThick/2.); // z size
 
-  auto solidAluWrap= new G4Box("solidAluWrapping",  //Name
-                                  aluwrapxy/2.,   // x size
-                                  aluwrapxy/2.,     // y size
-                                  aluwraplength/2.); // z size
+  fLogicCrystal = new G4LogicalVolume(solidCrystal,    //its solid
+                                        caloMat,    //its material
+                                        "logicCrystal");       //its name
 
+  if (fDetailLevel == "full"){
+    //---------------------------------------------------------------
+    // reflective aluminium wrapping  
+    //---------------------------------------------------------------
 
-  auto logicAluWrap = new G4LogicalVolume(solidAluWrap,    //its solid
-                                          Al,    //its material , changed it form Al to world material to test it 
-                                          "logicAluWrapping");       //its name
+    auto solidAluWrap= new G4Box("solidAluWrapping",  //Name
+                                    aluwrapxy/2.,   // x size
+                                    aluwrapxy/2.,     // y size
+                                    aluwraplength/2.); // z size
 
-  new G4PVPlacement(0,                   //no rotation
-                    G4ThreeVector(0.,0.,0.),    //its position // old 0.,0.,-detThick/2 
-                            logicAluWrap,            //its logical volume
-                            "physAluWrapping",                 //its name
-                            logicCaloCell,               //its mother
-                            false,                     //no boolean operat
-                            0);                        //copy number
 
-  G4VisAttributes * AluVis= new G4VisAttributes( G4Colour(119/255. ,136/255. ,153/255. ));
-  AluVis->SetVisibility(true);
-  AluVis->SetLineWidth(2);
-  AluVis->SetForceSolid(false);
-  logicAluWrap->SetVisAttributes(AluVis);
+    auto logicAluWrap = new G4LogicalVolume(solidAluWrap,    //its solid
+                                            Al,    //its material , changed it form Al to world material to test it 
+                                            "logicAluWrapping");       //its name
 
-  //---------------------------------------------------------------
-  // air gap between aluminium and crystal 
-  //---------------------------------------------------------------
-  auto solidAirGap = new G4Box("solidAirGap",  //Name
-                                alairgapxy/2.,   // x size
-                                alairgapxy/2.,     // y size
-                                alairgaplength/2.); // z size
+    new G4PVPlacement(0,                   //no rotation
+                      G4ThreeVector(0.,0.,0.),    //its position // old 0.,0.,-detThick/2 
+                              logicAluWrap,            //its logical volume
+                              "physAluWrapping",                 //its name
+                              logicCaloCell,               //its mother
+                              false,                     //no boolean operat
+                              0);                        //copy number
 
+    G4VisAttributes * AluVis= new G4VisAttributes( G4Colour(119/255. ,136/255. ,153/255. ));
+    AluVis->SetVisibility(true);
+    AluVis->SetLineWidth(2);
+    AluVis->SetForceSolid(false);
+    logicAluWrap->SetVisAttributes(AluVis);
 
-  auto logicAirGap = new G4LogicalVolume(solidAirGap,    //its solid
-                                        worldMat,    //its material chagend it to world material form Air 
-                                        "logicAirGap");       //its name
+    //---------------------------------------------------------------
+    // air gap between aluminium and crystal 
+    //---------------------------------------------------------------
+    auto solidAirGap = new G4Box("solidAirGap",  //Name
+                                  alairgapxy/2.,   // x size
+                                  alairgapxy/2.,     // y size
+                                  alairgaplength/2.); // z size
 
-  new G4PVPlacement(0,                   //no rotation
-                    G4ThreeVector(0.,0.,aluwrapthick),    //its position // old 0.,0.,-(aluwrapthick)/2
-                    logicAirGap,            //its logical volume
-                    "AlAirGap",                 //its name
-                    logicAluWrap,               //its mother
-                    false,                     //no boolean operat
-                    0);                        //copy number
 
-  //---------------------------------------------------------------
-  // crystal, here lead glass   
-  //---------------------------------------------------------------
-  auto solidCrystal = new G4Box("solidCrystal",  //Name
-                                 crystXY/2.,   // x size
-                                 crystXY/2.,     // y size
-                                 crystThick/2.); // z size
+    auto logicAirGap = new G4LogicalVolume(solidAirGap,    //its solid
+                                          worldMat,    //its material chagend it to world material form Air 
+                                          "logicAirGap");       //its name
 
-  fLogicCrystal = new G4LogicalVolume(solidCrystal,    //its solid
-                                        caloMat,    //its material
-                                        "logicCrystal");       //its name
+    new G4PVPlacement(0,                   //no rotation
+                      G4ThreeVector(0.,0.,aluwrapthick),    //its position // old 0.,0.,-(aluwrapthick)/2
+                      logicAirGap,            //its logical volume
+                      "AlAirGap",                 //its name
+                      logicAluWrap,               //its mother
+                      false,                     //no boolean operat
+                      0);                        //copy number
 
-  new G4PVPlacement(0,                   //no rotation
-                    G4ThreeVector(0.,0.,alairgapthick),    //its position old 0.,0.,alairgapthick/2
-                    fLogicCrystal,            //its logical volume
-                    "solidCrystal",                 //its name
-                    logicAirGap,               //its mother
-                    false,                     //no boolean operat
-                    0);                        //copy number
+    new G4PVPlacement(0,                   //no rotation
+                      G4ThreeVector(0.,0.,alairgapthick),    //its position old 0.,0.,alairgapthick/2
+                      fLogicCrystal,            //its logical volume
+                      "solidCrystal",                 //its name
+                      logicAirGap,               //its mother
+                      false,                     //no boolean operat
+                      0);                        //copy number
+  }
+  else{
+    // reduced/minimal: the micrometre wrapping and air gap are dropped, the crystal sits
+    // directly in the cell at the same position, so the cell pitch is unchanged
+    new G4PVPlacement(0,                   //no rotation
+                      G4ThreeVector(0.,0.,aluwrapthick+alairgapthick),    //its position
+                      fLogicCrystal,            //its logical volume
+                      "solidCrystal",                 //its name
+                      logicCaloCell,               //its mother
+                      false,                     //no boolean operat
+                      0);                        //copy number
+  }
 
   G4VisAttributes * CrystalVis= new G4VisAttributes( G4Colour(224/255. ,255/255. ,255/255. ));
   CrystalVis->SetVisibility(true);
@@ -253,37 +263,42 @@ G4LogicalVolume* Calorimeter::ConstructCalo() {
                                   crystXY/2,// former cystalXY now size of the calo chell changed back from calorcellxy
                                   detThick/2.);
 
-  fLogicFrontDet = new G4LogicalVolume(solidVacStep,    //its solid
-                                        Vacuum,    //its material
-                                        "logicCaloFrontDet");       //its name
-
-  new G4PVPlacement(0,                   //no rotation
-                    G4ThreeVector(0.,0., ffrontZPos),    //its position old 0.,0.,-(aluwraplength/2+detThick/2.)
-                    fLogicFrontDet,            //its logical volume
-                    "physCaloFrontDet",                 //its name
-                    logicCaloCell,               //its mother //old fCaloCellLV
-                    false,                     //no boolean operat
-                    0,                         //copy number
-                    true);                     // check for overlaps    
-
-  fLogicBackDet = new G4LogicalVolume(solidVacStep,    //its solid
-                                          Vacuum,    //its material
-                                          "VacStep4");       //its name
-
-   new G4PVPlacement(0,                   //no rotation
-                        G4ThreeVector(0.,0.,calorcelllength/2-detThick/2),    //its position old 0.,0.,(aluwrapthick+alairgaplength)/2
-                        fLogicBackDet,            //its logical volume
-                        "VacStep4",                 //its name
-                        logicCaloCell,               //its mother //old logicAluWrap
-                        false,                     //no boolean operat
-                        0);                        //copy number
-
   G4VisAttributes * DetVis= new G4VisAttributes( G4Colour(242/255. ,142/255. ,0/255. ));
   DetVis->SetVisibility(true);
   DetVis->SetLineWidth(2);
   DetVis->SetForceSolid(true);
-  fLogicBackDet->SetVisAttributes(DetVis);                     
-  fLogicFrontDet->SetVisAttributes(DetVis);  
+
+  // below the full detail level the virtual detectors are only built if they are read out
+  if (fDetailLevel == "full" || fConfig.GetConfigValueAsInt("Calorimeter","frontDetector")){
+    fLogicFrontDet = new G4LogicalVolume(solidVacStep,    //its solid
+                                          Vacuum,    //its material
+                                          "logicCaloFrontDet");       //its name
+
+    new G4PVPlacement(0,                   //no rotation
+                      G4ThreeVector(0.,0., ffrontZPos),    //its position old 0.,0.,-(aluwraplength/2+detThick/2.)
+                      fLogicFrontDet,            //its logical volume
+                      "physCaloFrontDet",                 //its name
+                      logicCaloCell,               //its mother //old fCaloCellLV
+                      false,                     //no boolean operat
+                      0,                         //copy number
+                      true);                     // check for overlaps    
+    fLogicFrontDet->SetVisAttributes(DetVis);  
+  }
+
+  if (fDetailLevel == "full" || fConfig.GetConfigValueAsInt("Calorimeter","backDetector")){
+    fLogicBackDet = new G4LogicalVolume(solidVacStep,    //its solid
+                                            Vacuum,    //its material
+                                            "VacStep4");       //its name
+
+     new G4PVPlacement(0,                   //no rotation
+                          G4ThreeVector(0.,0.,calorcelllength/2-detThick/2),    //its position old 0.,0.,(aluwrapthick+alairgaplength)/2
+                          fLogicBackDet,            //its logical volume
+                          "VacStep4",                 //its name
+                          logicCaloCell,               //its mother //old logicAluWrap
+                          false,                     //no boolean operat
+                          0);                        //copy number
+    fLogicBackDet->SetVisAttributes(DetVis);                     
+  }
   //---------------------------------------------------------------
   // If the full calorimeter is simulated -> also build housing    
   //---------------------------------------------------------------
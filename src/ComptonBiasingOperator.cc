@@ -0,0 +1,71 @@
+// ComptonBiasingOperator.cc
+#include "ComptonBiasingOperator.hh"
+
+#include "G4BiasingProcessInterface.hh"
+#include "G4BiasingProcessSharedData.hh"
+#include "G4BOptnChangeCrossSection.hh"
+#include "G4Gamma.hh"
+#include "G4ProcessManager.hh"
+#include "G4Track.hh"
+
+#include <cfloat>
+
+ComptonBiasingOperator::ComptonBiasingOperator(G4double xsScale)
+  : G4VBiasingOperator("ComptonBiasingOperator"),
+    fXSScale(xsScale),
+    fGamma(G4Gamma::Gamma()) {
+}
+
+ComptonBiasingOperator::~ComptonBiasingOperator() {
+    for (auto& entry : fOperations) {
+        delete entry.second;
+    }
+}
+
+void ComptonBiasingOperator::StartRun() {
+    // one operation per wrapped process, created once the processes exist
+    if (!fOperations.empty()) return;
+    const G4BiasingProcessSharedData* sharedData = G4BiasingProcessInterface::GetSharedData(fGamma->GetProcessManager());
+    if (!sharedData) {
+        G4cout << "ComptonBiasingOperator: no biased gamma process found" << G4endl;
+        return;
+    }
+    for (const auto* wrapper : sharedData->GetPhysicsBiasingProcessInterfaces()) {
+        G4String name = "XSscale-" + wrapper->GetWrappedProcess()->GetProcessName();
+        fOperations[wrapper] = new G4BOptnChangeCrossSection(name);
+    }
+}
+
+G4VBiasingOperation* ComptonBiasingOperator::ProposeOccurenceBiasingOperation(const G4Track* track,
+                                                                              const G4BiasingProcessInterface* callingProcess) {
+    if (track->GetDefinition() != fGamma) return nullptr;
+    auto it = fOperations.find(callingProcess);
+    if (it == fOperations.end()) return nullptr;
+
+    G4double analogLength = callingProcess->GetWrappedProcess()->GetCurrentInteractionLength();
+    if (analogLength > DBL_MAX/10.) return nullptr;
+    G4double biasedXS = fXSScale/analogLength;
+
+    G4BOptnChangeCrossSection* operation = it->second;
+    G4VBiasingOperation* previous = callingProcess->GetPreviousOccurenceBiasingOperation();
+    if (previous != operation || operation->GetInteractionOccured()) {
+        // new track in the core or the last sampled interaction happened: sample again
+        operation->SetBiasedCrossSection(biasedXS);
+        operation->Sample();
+    } else {
+        // the cross section changes along the track (energy, polarization), update the remaining path
+        operation->UpdateForStep(callingProcess->GetPreviousStepSize());
+        operation->SetBiasedCrossSection(biasedXS);
+        operation->UpdateForStep(0.0);
+    }
+    return operation;
+}
+
+void ComptonBiasingOperator::OperationApplied(const G4BiasingProcessInterface* callingProcess, G4BiasingAppliedCase,
+                                              G4VBiasingOperation* occurenceOperationApplied, G4double,
+                                              G4VBiasingOperation*, const G4VParticleChange*) {
+    auto it = fOperations.find(callingProcess);
+    if (it != fOperations.end() && it->second == occurenceOperationApplied) {
+        it->second->SetInteractionOccured();
+    }
+}
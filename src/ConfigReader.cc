@@ -4,6 +4,8 @@
 #include <iostream>
 #include <stdexcept>
 #include <exception>
+#include <algorithm>
+#include <cmath>
 #include "G4ThreeVector.hh"
 
 ConfigReader::ConfigReader(const std::string& configFile)
@@ -121,6 +123,296 @@ int ConfigReader::ReadShowerDevStat() const {
         }
         return 0; // default value
     }
+int ConfigReader::ReadPairedStatus() const {
+        // paired runs only make sense if two polarization states are simulated
+        if (GetConfigValue("Run", "type") != "asymmetry" || !ReadIntOrDefault("Run", "paired", 0)) {
+            return 0;
+        }
+        // the differences are taken per event, sums over several events are not reset per event
+        std::string mode = ReadOutputMode();
+        if (mode == "SumRun" || mode == "block") {
+            std::cerr << "[Run] paired needs per event sums and is not used with output mode " << mode << std::endl;
+            return 0;
+        }
+        return 1;
+    }
+G4double ConfigReader::ReadAsymPrecision() const {
+        // absolute error of the asymmetry, the online estimator needs both polarization states
+        if (!GetConfigValue("Run", "precision").empty()) {
+            std::cerr << "[Run] precision is not used, the target error of the asymmetry is absPrecision" << std::endl;
+        }
+        if (GetConfigValue("Run", "type") != "asymmetry" || GetConfigValue("Run", "absPrecision").empty()) {
+            return 0;
+        }
+        G4double precision = GetConfigValueAsDouble("Run", "absPrecision");
+        if (precision <= 0) {
+            return 0;
+        }
+        // the estimator adds one entry per event, sums over several events are not reset per event
+        std::string mode = ReadOutputMode();
+        if (mode == "SumRun" || mode == "block") {
+            std::cerr << "[Run] absPrecision needs per event sums and is not used with output mode " << mode << std::endl;
+            return 0;
+        }
+        return precision;
+    }
+int ConfigReader::ReadBlockSize() const {
+        if (ReadOutputMode() != "block") {
+            return 1;
+        }
+        // the chunks of one bunch are always summed into one row
+        int nChunks = ReadBunchChunks();
+        if (nChunks > 1) {
+            return nChunks;
+        }
+        int blockSize = ReadIntOrDefault("Output", "blockSize", 1);
+        return blockSize > 0 ? blockSize : 1;
+    }
+int ConfigReader::ReadStreamSize() const {
+        // primaries per injected group, 0: all primaries of an event are generated at once
+        int streamSize = ReadIntOrDefault("GPS", "streamSize", 0);
+        return streamSize > 0 ? streamSize : 0;
+    }
+int ConfigReader::ReadNBunch() const {
+        // the response matrix is per incident photon, so every event is one photon
+        if (GetConfigValue("Run", "type") == "response") {
+            return 1;
+        }
+        return ReadIntOrDefault("GPS", "nBunch", 1);
+    }
+int ConfigReader::ReadBunchChunks() const {
+        // a bunch of nBunch primaries is simulated as nChunks consecutive events
+        int nChunks = ReadIntOrDefault("GPS", "nChunks", 1);
+        int nBunch = ReadNBunch();
+        if (nChunks <= 1) {
+            return 1;
+        }
+        return nChunks < nBunch ? nChunks : nBunch;
+    }
+int ConfigReader::ReadSparseStatus() const {
+        // only the per event summary rows can be skipped
+        if (ReadOutputMode() != "summary") {
+            return 0;
+        }
+        return ReadIntOrDefault("Output", "sparse", 0);
+    }
+std::string ConfigReader::ReadDetailedLayout() const {
+        // row: one row per hit, vector: one row per event with vector columns
+        std::string layout = GetConfigValue("Output", "detailedLayout");
+        if (layout == "vector") {
+            return layout;
+        }
+        if (!layout.empty() && layout != "row") {
+            std::cerr << "Unknown [Output] detailedLayout " << layout << ", using row" << std::endl;
+        }
+        return "row";
+    }
+int ConfigReader::ReadTrackHistoryStatus() const {
+        // only the per hit output references tracks
+        int showerDev = ReadShowerDevStat();
+        if (ReadOutputMode() != "detailed" && showerDev != 1 && showerDev != 3) {
+            return 0;
+        }
+        return ReadIntOrDefault("Output", "trackHistory", 0);
+    }
+int ConfigReader::ReadTriggerStatus() const {
+        // the trigger decides per event, sums over several events are not filtered
+        std::string mode = ReadOutputMode();
+        if (mode == "SumRun" || mode == "block") {
+            return 0;
+        }
+        G4double edepMin = GetConfigValue("Trigger", "caloEdepMin").empty() ? 0 : GetConfigValueAsDouble("Trigger", "caloEdepMin");
+        return edepMin > 0 || ReadIntOrDefault("Trigger", "requireFrontHit", 0);
+    }
+int ConfigReader::ReadClusterStatus() const {
+        // one cluster per event, needs the crystal sums
+        std::string mode = ReadOutputMode();
+        if (mode == "SumRun" || mode == "block" || !ReadIntOrDefault("Calorimeter", "crystDetector", 0)) {
+            return 0;
+        }
+        return ReadIntOrDefault("Output", "cluster", 0);
+    }
+namespace {
+    // the old nCrystals key only knows 1 and 9 crystals, 0 for invalid counts
+    int NCrystalsSide(int nCrystals) {
+        return nCrystals == 1 ? 1 : (nCrystals == 9 ? 3 : 0);
+    }
+}
+int ConfigReader::ReadNCrystalsX() const {
+        // the full calorimeter with its housing is always 3x3
+        if (GetConfigValue("Calorimeter", "type") == "full") {
+            return 3;
+        }
+        if (!GetConfigValue("Calorimeter", "nCrystalsX").empty()) {
+            return GetConfigValueAsInt("Calorimeter", "nCrystalsX");
+        }
+        return NCrystalsSide(ReadIntOrDefault("Calorimeter", "nCrystals", 9));
+    }
+int ConfigReader::ReadNCrystalsY() const {
+        if (GetConfigValue("Calorimeter", "type") == "full") {
+            return 3;
+        }
+        if (!GetConfigValue("Calorimeter", "nCrystalsY").empty()) {
+            return GetConfigValueAsInt("Calorimeter", "nCrystalsY");
+        }
+        return NCrystalsSide(ReadIntOrDefault("Calorimeter", "nCrystals", 9));
+    }
+std::string ConfigReader::ReadDetailLevel() const {
+        // full: all volumes, reduced: no micrometre wraps/gaps and no unused virtual detectors,
+        // minimal: additionally simplified magnet housing and no table
+        std::string level = GetConfigValue("Geometry", "detailLevel");
+        if (level == "reduced" || level == "minimal") {
+            return level;
+        }
+        if (!level.empty() && level != "full") {
+            std::cerr << "Unknown [Geometry] detailLevel " << level << ", using full" << std::endl;
+        }
+        return "full";
+    }
+std::vector<ScoringPlaneInfo> ConfigReader::ReadScoringPlanes() const {
+        std::vector<ScoringPlaneInfo> planes;
+        auto sectionIt = fConfigValues.find("ScoringPlanes");
+        if (sectionIt == fConfigValues.end()) {
+            return planes;
+        }
+        // the names become trees and sensitive detectors next to the built in ones
+        const std::vector<std::string> reserved = {"inFrontCore", "behindCore", "inFrontCalo", "CaloCrystal", "behindCalo"};
+        for (const auto& entry : sectionIt->second) {
+            if (std::find(reserved.begin(), reserved.end(), entry.first) != reserved.end()) {
+                std::cerr << "Scoring plane " << entry.first << " uses the name of a detector, skipped" << std::endl;
+                continue;
+            }
+            ScoringPlaneInfo plane{entry.first, 0., 0., 0., 0., 0.};
+            std::istringstream iss(entry.second);
+            if (!(iss >> plane.z >> plane.sizeX >> plane.sizeY) || plane.sizeX <= 0 || plane.sizeY <= 0) {
+                std::cerr << "Failed to parse scoring plane " << entry.first << ": " << entry.second << std::endl;
+                continue;
+            }
+            // the rotation is optional
+            if (!(iss >> plane.xRot >> plane.yRot)) {
+                plane.xRot = 0.;
+                plane.yRot = 0.;
+            }
+            planes.push_back(plane);
+        }
+        return planes;
+    }
+int ConfigReader::ReadResponseStatus() const {
+        // the response needs the per event crystal sums
+        if (GetConfigValue("Run", "type") != "response") {
+            return 0;
+        }
+        std::string mode = ReadOutputMode();
+        if (mode == "SumRun" || mode == "block" || !ReadIntOrDefault("Calorimeter", "crystDetector", 0)) {
+            std::cerr << "Run type response needs the crystal detector and per event sums, not mode " << mode << std::endl;
+            return 0;
+        }
+        return 1;
+    }
+std::vector<double> ConfigReader::ReadResponseEnergies() const {
+        // photon energies in MeV, either listed or a grid from Emin to Emax
+        std::vector<double> energies;
+        std::string list = GetConfigValue("Response", "energies");
+        if (!list.empty()) {
+            std::istringstream iss(list);
+            double energy;
+            while (iss >> energy) {
+                energies.push_back(energy);
+            }
+            std::sort(energies.begin(), energies.end());
+            return energies;
+        }
+        int nEnergies = ReadIntOrDefault("Response", "nEnergies", 0);
+        if (nEnergies < 1) {
+            return energies;
+        }
+        double eMin = GetConfigValueAsDouble("Response", "Emin");
+        double eMax = GetConfigValueAsDouble("Response", "Emax");
+        bool logGrid = GetConfigValue("Response", "grid") == "log" && eMin > 0;
+        for (int i = 0; i < nEnergies; ++i) {
+            double f = nEnergies > 1 ? double(i)/(nEnergies - 1) : 0.;
+            energies.push_back(logGrid ? eMin*std::pow(eMax/eMin, f) : eMin + f*(eMax - eMin));
+        }
+        return energies;
+    }
+int ConfigReader::ReadCrossCheckEvents() const {
+        // events per polarization sign of the fastscan cross-check runs
+        if (GetConfigValue("Run", "type") != "fastscan") {
+            return 0;
+        }
+        int nEvents = ReadIntOrDefault("FastScan", "crossCheck", 0);
+        return nEvents > 0 ? nEvents : 0;
+    }
+std::string ConfigReader::ReadCoreBiasing() const {
+        // none, scale (cross section times xsScale) or force (forced interaction) in the iron core
+        std::string mode = GetConfigValue("Biasing", "coreBiasing");
+        if (mode.empty() || mode == "none") {
+            return "none";
+        }
+        if (mode != "scale" && mode != "force") {
+            std::cerr << "Unknown [Biasing] coreBiasing " << mode << ", biasing off" << std::endl;
+            return "none";
+        }
+        if (!GetConfigValueAsInt("Solenoid", "solenoidStatus")) {
+            std::cerr << "[Biasing] coreBiasing needs the solenoid, biasing off" << std::endl;
+            return "none";
+        }
+        return mode;
+    }
+int ConfigReader::ReadImportanceStatus() const {
+        // importance slabs between zMin and zMax, see ImportanceParallelWorld
+        if (!ReadIntOrDefault("Importance", "status", 0)) {
+            return 0;
+        }
+        if (ReadIntOrDefault("Importance", "nCells", 1) < 1
+            || GetConfigValueAsDouble("Importance", "zMax") <= GetConfigValueAsDouble("Importance", "zMin")) {
+            std::cerr << "[Importance] needs nCells >= 1 and zMax > zMin, importance biasing off" << std::endl;
+            return 0;
+        }
+        return 1;
+    }
+std::vector<std::string> ConfigReader::ReadImportanceParticles() const {
+        // particles which are split and rouletted, default the photons
+        std::vector<std::string> particles;
+        std::istringstream iss(GetConfigValue("Importance", "particles"));
+        std::string particle;
+        while (iss >> particle) {
+            particles.push_back(particle);
+        }
+        if (particles.empty()) {
+            particles.push_back("gamma");
+        }
+        return particles;
+    }
+int ConfigReader::ReadWeightStatus() const {
+        // the track weights are only written if a biasing can change them
+        return ReadCoreBiasing() != "none" || ReadImportanceStatus();
+    }
+int ConfigReader::ReadStackingStatus() const {
+        return ReadIntOrDefault("Stacking", "status", 0);
+    }
+std::vector<StackClassInfo> ConfigReader::ReadStackClasses() const {
+        // <class>Policy and <class>Cap per stack class, optical photons are deferred by default
+        std::vector<StackClassInfo> classes = {{"optical", "defer", 0}, {"low", "process", 0}, {"high", "process", 0}};
+        for (auto& stackClass : classes) {
+            std::string policy = GetConfigValue("Stacking", stackClass.name + "Policy");
+            if (policy == "process" || policy == "defer" || policy == "kill") {
+                stackClass.policy = policy;
+            } else if (!policy.empty()) {
+                std::cerr << "Unknown [Stacking] " << stackClass.name << "Policy " << policy << ", using " << stackClass.policy << std::endl;
+            }
+            int cap = ReadIntOrDefault("Stacking", stackClass.name + "Cap", 0);
+            stackClass.cap = cap > 0 ? cap : 0;
+        }
+        return classes;
+    }
+int ConfigReader::ReadIntOrDefault(const std::string& section, const std::string& key, int defaultValue) const {
+        // optional keys: missing ones fall back to the default without an error message
+        if (GetConfigValue(section, key).empty()) {
+            return defaultValue;
+        }
+        return GetConfigValueAsInt(section, key);
+    }
 std::vector<TreeInfo> ConfigReader::ReadTreesInfo() const {
     // Logic to read tree configurations from fConfigValues
 
@@ -166,6 +458,11 @@ std::vector<TreeInfo> ConfigReader::ReadTreesInfo() const {
             trees.push_back(TreeInfo("behindCalo", "behindCalo", treeID));
         }
     }
+    // scoring planes in the parallel world follow the detectors of the mass geometry
+    for (const auto& plane : ReadScoringPlanes()) {
+        G4cout << "The scoring plane " << plane.name << " is at z = " << plane.z << " mm" << G4endl;
+        trees.push_back(TreeInfo(plane.name, plane.name, trees.size()));
+    }
     G4cout << "trees size: " << trees.size() << G4endl;
     return trees;
 }
@@ -231,93 +528,141 @@ std::vector<BranchInfo> ConfigReader::GetBranchesInfo(const std::string& treeNam
                     {"EventID","I"},
                     {"crystNo","I"}
                 };
-            }else{
-                branches = { 
-                {"Edep_0","D"},
-                {"Edep_1","D"},
-                {"Edep_2","D"},
-                {"Edep_3","D"},
-                {"Edep_4","D"},
-                {"Edep_5","D"},
-                {"Edep_6","D"},
-                {"Edep_7","D"},
-                {"Edep_8","D"},
-                {"Edep_ct_0","D"},
-                {"Edep_ct_1","D"},
-                {"Edep_ct_2","D"},
-                {"Edep_ct_3","D"},
-                {"Edep_ct_4","D"},
-                {"Edep_ct_5","D"},
-                {"Edep_ct_6","D"},
-                {"Edep_ct_7","D"},
-                {"Edep_ct_8","D"}
+                if (ReadWeightStatus()){
+                    branches.push_back({"weight","D"});
+                }
+            }else if(GetConfigValueAsInt("Calorimeter","showerDev")==3){
+                // one row per track segment in a crystal
+                branches = {
+                    {"pdg","I"},
+                    {"E","D"},
+                    {"Edep","D"},
+                    {"Edep_ct","D"},
+                    {"xIn","D"},
+                    {"yIn","D"},
+                    {"zIn","D"},
+                    {"xOut","D"},
+                    {"yOut","D"},
+                    {"zOut","D"},
+                    {"nSteps","I"},
+                    {"TrackID","I"},
+                    {"ParentID","I"},
+                    {"EventID","I"},
+                    {"crystNo","I"}
                 };
+                if (ReadWeightStatus()){
+                    branches.push_back({"weight","D"});
+                }
+            }else if (mode == "stats"){
+                branches = GetStatsBranchesInfo();
+            }else{
+                branches = GetSummaryBranchesInfo(treeName);
+                if (mode == "block"){
+                    branches.push_back({"nEvents","I"});
+                } else if (ReadSparseStatus()){
+                    branches.push_back({"EventID","I"});
+                }
             }
             return branches ;
         }
 
 
     if (mode == "detailed"){
+        // with the track history table the vertex and the parent are stored once per track
+        bool trackHistory = ReadTrackHistoryStatus();
         branches = {
             {"pdg", "I"},
             {"E", "D"},
             {"x", "D"},
             {"y", "D"},
-            {"z", "D"},
-            {"startx", "D"},
-            {"starty", "D"},
-            {"startz", "D"},
+            {"z", "D"}
+        };
+        if (!trackHistory){
+            branches.push_back({"startx", "D"});
+            branches.push_back({"starty", "D"});
+            branches.push_back({"startz", "D"});
+        }
+        branches.insert(branches.end(), {
             {"px", "D"},
             {"py", "D"},
             {"pz", "D"},
             {"Polx", "D"},
             {"Poly", "D"},
             {"Polz", "D"},
-            {"TrackID", "D"},
-            {"ParentID", "D"},
-            {"EventID", "D"}
-        };
+            {"TrackID", "D"}
+        });
+        if (!trackHistory){
+            branches.push_back({"ParentID", "D"});
+        }
+        branches.push_back({"EventID", "D"});
         if (treeName == "inFrontCalo" || treeName =="behindCalo" ){
             branches.push_back({"crystNo","I"});
         }
+        if (ReadWeightStatus()){ // track weight of the biased runs
+            branches.push_back({"weight","D"});
+        }
+    }else if (mode == "stats"){ // one row per summary column
+        branches = GetStatsBranchesInfo();
     }else{ // use summary mode
-        if (treeName == "inFrontCalo" || treeName == "behindCalo"){
-            branches = {
-                {"Esum_0","D"},
-                {"Esum_1","D"},
-                {"Esum_2","D"},
-                {"Esum_3","D"},
-                {"Esum_4","D"},
-                {"Esum_5","D"},
-                {"Esum_6","D"},
-                {"Esum_7","D"},
-                {"Esum_8","D"},
-                {"NP_0","D"},
-                {"NP_1","D"},
-                {"NP_2","D"},
-                {"NP_3","D"},
-                {"NP_4","D"},
-                {"NP_5","D"},
-                {"NP_6","D"},
-                {"NP_7","D"},
-                {"NP_8","D"}
-
-            };
-            return branches;
+        branches = GetSummaryBranchesInfo(treeName);
+        if (mode == "block"){ // sums of blockSize events
+            branches.push_back({"nEvents","I"});
+        } else if (ReadSparseStatus()){ // empty events are skipped
+            branches.push_back({"EventID","I"});
         }
-        branches = {
-            {"Esum", "D"},
-            {"NP", "I"},
-            {"EGammaSum", "D"},
-            {"NGamma", "I"},
-            {"EeSum", "D"},
-            {"Ne", "I"}
-        };
     }
 
     return branches;
 }
 
+std::vector<BranchInfo> ConfigReader::GetSummaryBranchesInfo(const std::string& treeName) const {
+    // columns of the per event (or per run) sums of a detector
+    std::vector<BranchInfo> branches;
+    // one column per crystal, the index is the copy number of the calorimeter cell
+    int nCrystals = ReadNCrystalsX()*ReadNCrystalsY();
+    if (treeName == "CaloCrystal"){
+        for (int i = 0; i < nCrystals; ++i) {
+            branches.push_back({"Edep_" + std::to_string(i), "D"});
+        }
+        for (int i = 0; i < nCrystals; ++i) {
+            branches.push_back({"Edep_ct_" + std::to_string(i), "D"});
+        }
+        return branches;
+    }
+    if (treeName == "inFrontCalo" || treeName == "behindCalo"){
+        for (int i = 0; i < nCrystals; ++i) {
+            branches.push_back({"Esum_" + std::to_string(i), "D"});
+        }
+        for (int i = 0; i < nCrystals; ++i) {
+            branches.push_back({"NP_" + std::to_string(i), "D"});
+        }
+        return branches;
+    }
+    // the counts are weighted in biased runs
+    std::string countType = ReadWeightStatus() ? "D" : "I";
+    branches = {
+        {"Esum", "D"},
+        {"NP", countType},
+        {"EGammaSum", "D"},
+        {"NGamma", countType},
+        {"EeSum", "D"},
+        {"Ne", countType}
+    };
+    return branches;
+}
+
+std::vector<BranchInfo> ConfigReader::GetStatsBranchesInfo() const {
+    // stats mode: one row per summary column with its moments
+    std::vector<BranchInfo> branches = {
+        {"column", "S"},
+        {"N", "I"},
+        {"mean", "D"},
+        {"variance", "D"},
+        {"skew", "D"}
+    };
+    return branches;
+}
+
 const std::map<std::string, std::map<std::string, std::string>>& ConfigReader::GetConfigValues() const {
     return fConfigValues;
 }
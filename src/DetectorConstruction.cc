@@ -1,6 +1,8 @@
 // DetectorConstruction.cc
 #include "DetectorConstruction.hh"
 #include "Solenoid.hh"
+#include "ScoringParallelWorld.hh"
+#include "ImportanceParallelWorld.hh"
 #include "Materials.hh"
 #include "ConfigReader.hh"
 #include "G4SDManager.hh"
@@ -21,6 +23,15 @@ DetectorConstruction::DetectorConstruction(const ConfigReader& config, AnaConfig
     fCalo = new Calorimeter(config, anaConfigManager);
     fBeamLine = new BeamLine(config, anaConfigManager);
 
+    // scoring planes live in their own parallel world
+    if (!config.ReadScoringPlanes().empty()) {
+      RegisterParallelWorld(new ScoringParallelWorld(config, anaConfigManager));
+    }
+    // as do the cells of the importance biasing
+    if (config.ReadImportanceStatus()) {
+      RegisterParallelWorld(new ImportanceParallelWorld(config));
+    }
+
 
     //initialize other geometry member variables 
     fWorldMaterial = config.GetConfigValue("World", "material");
@@ -114,6 +125,7 @@ void DetectorConstruction::ConstructSDandField(){
     if(fConfig.GetConfigValueAsInt("Solenoid","BField")){
       fSolenoid->ConstructSolenoidBfield();
     }
+    fSolenoid->ConstructSolenoidBiasing();
   } 
 
   if(fConfig.GetConfigValueAsInt("Calorimeter","calorimeterStatus")){
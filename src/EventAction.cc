@@ -13,7 +13,10 @@ EventAction::EventAction(AnaConfigManager& anaConfigManager)
     : G4UserEventAction(),
       fAnaConfigManager(anaConfigManager),
       fOutputMode(anaConfigManager.GetOutputMode()), // Initialize from AnaConfigManager
-      fTreesInfo(anaConfigManager.GetTreesInfo()) { // Initialize from AnaConfigManager
+      fTreesInfo(anaConfigManager.GetTreesInfo()), // Initialize from AnaConfigManager
+      fPairedStatus(anaConfigManager.GetPairedStatus()),
+      fAsymEstimate(anaConfigManager.GetAsymEstimate()),
+      fBlockSize(anaConfigManager.GetBlockSize()) {
 
     // constructor body
 }
@@ -21,10 +24,23 @@ EventAction::EventAction(AnaConfigManager& anaConfigManager)
 EventAction::~EventAction() {
 }
 
-void EventAction::BeginOfEventAction(const G4Event*) {
+void EventAction::BeginOfEventAction(const G4Event* event) {
     G4SDManager* sdManager = G4SDManager::GetSDMpointer();
 
-    if(fOutputMode == "summary"){
+    // per event abort counters, also the energy budget for EinLimit
+    if (fAnaConfigManager.GetAbortStatus()) {
+        fAnaConfigManager.BeginOfEventAbort();
+    }
+
+    // per event counts of the stacking policy
+    if (fAnaConfigManager.GetStackingStatus()) {
+        fAnaConfigManager.BeginOfEventStacking();
+    }
+
+    // in block mode the sums are only reset at the start of a new block
+    G4bool newBlock = event->GetEventID() % fBlockSize == 0;
+
+    if(fOutputMode == "summary" || fOutputMode == "stats" || (fOutputMode == "block" && newBlock)){
     for (const auto& treeInfo : fTreesInfo) {
         G4VSensitiveDetector* mySD = sdManager->FindSensitiveDetector(treeInfo.name);
 
@@ -51,6 +67,9 @@ void EventAction::BeginOfEventAction(const G4Event*) {
                 if (treeInfo.name == "CaloCrystal"){
                     CaloCrystalSD* specSD = dynamic_cast<CaloCrystalSD*>(mySD);
                     specSD->Reset();
+                }else if (treeInfo.name == "inFrontCalo" && fAnaConfigManager.NeedsFrontSums()){
+                    CaloFrontSensitiveDetector* specSD = dynamic_cast<CaloFrontSensitiveDetector*>(mySD);
+                    specSD->Reset();
                 }
             }
         }
@@ -58,8 +77,34 @@ void EventAction::BeginOfEventAction(const G4Event*) {
     
 }
 
-void EventAction::EndOfEventAction(const G4Event*) {
-    if (fOutputMode == "summary") {
+void EventAction::EndOfEventAction(const G4Event* event) {
+    // block mode: one row with the sums of the last fBlockSize events
+    G4bool writeRows = true;
+    if (fOutputMode == "block") {
+        writeRows = (event->GetEventID()+1) % fBlockSize == 0;
+        fAnaConfigManager.SetBlockEventCount(fBlockSize);
+    }
+
+    // aborted events are flagged with the reason
+    if (fAnaConfigManager.GetAbortStatus()) {
+        fAnaConfigManager.EndOfEventAbort(event->GetEventID());
+    }
+
+    // peak stack depth and killed tracks, independent of the trigger
+    if (fAnaConfigManager.GetStackingStatus()) {
+        fAnaConfigManager.EndOfEventStacking(event->GetEventID());
+    }
+
+    // trigger on the calorimeter sums, only accepted events are written
+    G4bool triggered = true;
+    if (fAnaConfigManager.GetTriggerStatus()) {
+        G4double edep, ein;
+        GetCaloObservables(edep, ein);
+        triggered = fAnaConfigManager.ApplyTrigger(edep, ein);
+        writeRows = writeRows && triggered;
+    }
+
+    if (writeRows && (fOutputMode == "summary" || fOutputMode == "stats" || fOutputMode == "block")) {
         G4SDManager* sdManager = G4SDManager::GetSDMpointer();
         
         for (const auto& treeInfo : fTreesInfo) {
@@ -67,7 +112,7 @@ void EventAction::EndOfEventAction(const G4Event*) {
                 CaloFrontSensitiveDetector* mySD = static_cast<CaloFrontSensitiveDetector*>(sdManager->FindSensitiveDetector(treeInfo.name));
                 if (!mySD) continue;
                 std::vector<double> energySum = mySD->GetEnergySum();
-                std::vector<int> Ntot = mySD->GetTotalCount();
+                std::vector<double> Ntot = mySD->GetTotalCount();
                 //G4cout << "CaloFrontSensitiveDetector Address in EventAction: " << mySD << ", Size: " << energySum.size() << G4endl;
                 //G4cout << "-------ooooooooooooo-----------ooooooooooooooooooo---------ooooooooooooooo----- energySum has length " << energySum.size() << G4endl;
                 fAnaConfigManager.FillCaloFrontTuple_summary(mySD->GetTupleID(), Ntot, energySum);
@@ -79,14 +124,14 @@ void EventAction::EndOfEventAction(const G4Event*) {
                 if (!mySD) continue;
 
                 G4double energySum = mySD->GetEnergySum();
-                G4int Ntot = mySD->GetTotalCount();
+                G4double Ntot = mySD->GetTotalCount();
                 G4double EgammaSum = mySD->GetGammaEnergySum();
-                G4int Ngamma = mySD->GetGammaCount();
+                G4double Ngamma = mySD->GetGammaCount();
                 G4double EeSum = mySD->GetElectronEnergySum();
-                G4int Ne = mySD->GetElectronCount();
+                G4double Ne = mySD->GetElectronCount();
 
                 // These vectors are automatically passed by const reference due to the function signature
-                std::vector<int> particleCounts = {Ntot, Ngamma, Ne};
+                std::vector<G4double> particleCounts = {Ntot, Ngamma, Ne};
                 std::vector<G4double> energySums = {energySum, EgammaSum, EeSum};
 
                 fAnaConfigManager.FillBaseNtuple_summary(mySD->GetTupleID(), particleCounts, energySums);
@@ -94,7 +139,7 @@ void EventAction::EndOfEventAction(const G4Event*) {
         }
     }
     for (const auto& treeInfo : fTreesInfo) {
-        if(treeInfo.name == "CaloCrystal" && (fOutputMode == "summary" || fOutputMode == "detailed")) {
+        if(writeRows && treeInfo.name == "CaloCrystal" && !fAnaConfigManager.HasCrystalHitTuple() && fOutputMode != "SumRun") {
             G4SDManager* sdManager = G4SDManager::GetSDMpointer();
             CaloCrystalSD* mySD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector(treeInfo.name));
             if (!mySD) continue;
@@ -105,4 +150,82 @@ void EventAction::EndOfEventAction(const G4Event*) {
 
         }
     }
+    // cluster of the crystal sums and the front detector hits
+    if (writeRows && fAnaConfigManager.GetClusterStatus()) {
+        G4SDManager* sdManager = G4SDManager::GetSDMpointer();
+        CaloCrystalSD* crystSD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector("CaloCrystal", false));
+        CaloFrontSensitiveDetector* frontSD = static_cast<CaloFrontSensitiveDetector*>(sdManager->FindSensitiveDetector("inFrontCalo", false));
+        if (crystSD) {
+            G4double ein = 0., einX = 0., einY = 0.;
+            if (frontSD) {
+                for (const auto& value : frontSD->GetEnergySum()) { ein += value; }
+                einX = frontSD->GetEnergyX();
+                einY = frontSD->GetEnergyY();
+            }
+            fAnaConfigManager.FillCaloCluster(crystSD->GetEdepTot(), ein, einX, einY);
+        }
+    }
+    // track segments which are still open at the end of the event
+    if (fAnaConfigManager.GetShowerDevStat() == 3) {
+        G4SDManager* sdManager = G4SDManager::GetSDMpointer();
+        CaloCrystalSD* mySD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector("CaloCrystal", false));
+        if (mySD) mySD->FlushSegment();
+    }
+    // tracks with hits in this event and their ancestors
+    if (fAnaConfigManager.GetTrackHistoryStatus()) {
+        fAnaConfigManager.WriteTrackHistory(event->GetEventID(), triggered);
+    }
+    // voxelised shower development of this event
+    if (fAnaConfigManager.GetShowerDevStat() == 2 && fAnaConfigManager.GetShowerWrite() == "event") {
+        fAnaConfigManager.WriteShowerGrid(event->GetEventID(), triggered);
+    }
+    // vector layout: the hits of this event go into one row per detector,
+    // with trigger the buffered rows are written or dropped
+    if (fAnaConfigManager.GetDetailedLayout() == "vector" || fAnaConfigManager.GetTriggerStatus()) {
+        fAnaConfigManager.WriteHitBuffers(event->GetEventID(), triggered);
+    }
+    // response runs: every event counts, also the ones rejected by the trigger
+    if (fAnaConfigManager.GetResponseStatus()) {
+        G4SDManager* sdManager = G4SDManager::GetSDMpointer();
+        CaloCrystalSD* crystSD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector("CaloCrystal", false));
+        if (crystSD) {
+            G4double edep, ein;
+            GetCaloObservables(edep, ein);
+            fAnaConfigManager.AddResponseEvent(crystSD->GetEdepTot(), ein);
+        }
+    }
+    // biased runs: weighted calorimeter sums for the figure of merit
+    if (fAnaConfigManager.GetFomStatus()) {
+        G4double edep, ein;
+        GetCaloObservables(edep, ein);
+        fAnaConfigManager.AddWeightedEvent(edep, ein);
+    }
+    if (fPairedStatus || fAsymEstimate) {
+        G4double edep, ein;
+        GetCaloObservables(edep, ein);
+        if (fPairedStatus) {
+            fAnaConfigManager.FillPairedTuple(event->GetEventID(), edep, ein);
+        }
+        // soft abort: the current event is finished, the run ends afterwards
+        if (fAsymEstimate && fAnaConfigManager.AddAsymmetryEvent(edep, ein)) {
+            G4RunManager::GetRunManager()->AbortRun(true);
+        }
+    }
+}
+
+void EventAction::GetCaloObservables(G4double& edep, G4double& ein) const {
+    edep = 0.;
+    ein = 0.;
+    G4SDManager* sdManager = G4SDManager::GetSDMpointer();
+    for (const auto& treeInfo : fTreesInfo) {
+        if (treeInfo.name == "CaloCrystal") {
+            CaloCrystalSD* mySD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector(treeInfo.name));
+            if (!mySD) continue;
+            for (const auto& value : mySD->GetEdepTot()) { edep += value; }
+        } else if (treeInfo.name == "inFrontCalo") {
+            CaloFrontSensitiveDetector* mySD = static_cast<CaloFrontSensitiveDetector*>(sdManager->FindSensitiveDetector(treeInfo.name));
+            if (!mySD) continue;
+            for (const auto& value : mySD->GetEnergySum()) { ein += value; }
+        }
+    }
 }
\ No newline at end of file
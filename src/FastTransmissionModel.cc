@@ -0,0 +1,228 @@
+// FastTransmissionModel.cc
+#include "FastTransmissionModel.hh"
+#include "Materials.hh"
+
+#include "G4EmCalculator.hh"
+#include "G4Gamma.hh"
+#include "G4Material.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+FastTransmissionModel::FastTransmissionModel(const ConfigReader& config)
+  : fConfig(config) {
+    fFileName = config.GetConfigValue("Output", "fileName");
+    // same material as the core in Solenoid
+    fCoreMaterial = Materials::GetInstance()->GetMaterial("G4_Fe");
+    // circular polarization of the photons at the core, default the one of the source
+    if (!config.GetConfigValue("FastScan", "photonPol").empty()) {
+        fPhotonPol = config.GetConfigValueAsDouble("FastScan", "photonPol");
+    } else {
+        fPhotonPol = config.GetConfigValueAsDouble("GPS", "polDeg");
+    }
+    fNSub = config.ReadIntOrDefault("FastScan", "nSub", 4);
+    if (fNSub < 1) fNSub = 1;
+    if (config.GetConfigValue("GPS", "particle") != "gamma") {
+        G4cout << "----> fastscan: the spectrum is taken as the photon spectrum at the core, the source particle is "
+               << config.GetConfigValue("GPS", "particle") << G4endl;
+    }
+}
+
+FastTransmissionModel::~FastTransmissionModel() {}
+
+std::vector<G4double> FastTransmissionModel::ReadList(const std::string& key, G4double defaultValue) const {
+    // scan values of one parameter, the [Solenoid] value if not given
+    std::vector<G4double> values;
+    std::istringstream iss(fConfig.GetConfigValue("FastScan", key));
+    G4double value;
+    while (iss >> value) {
+        values.push_back(value);
+    }
+    if (values.empty()) {
+        values.push_back(defaultValue);
+    }
+    return values;
+}
+
+void FastTransmissionModel::ReadSpectrum() {
+    fBinEnergies.clear();
+    fBinWeights.clear();
+    std::string eneType = fConfig.GetConfigValue("GPS", "eneType");
+    if (eneType == "User") {
+        // /gps/hist/point E weight, the first point is the lower edge
+        std::string histFilePath = fConfig.GetConfigValue("GPS", "histname");
+        std::ifstream histFile(histFilePath);
+        if (!histFile.is_open()) {
+            G4cerr << "Error: Cannot open the file: " << histFilePath << G4endl;
+            return;
+        }
+        std::string line;
+        while (std::getline(histFile, line)) {
+            std::istringstream iss(line);
+            std::string command;
+            G4double energy, weight;
+            if (iss >> command >> energy >> weight && command == "/gps/hist/point") {
+                fBinEnergies.push_back(energy);
+                fBinWeights.push_back(weight);
+            }
+        }
+    } else {
+        // monoenergetic, also for Gauss (the width is neglected)
+        G4double energy = fConfig.GetConfigValueAsDouble("GPS", "energy");
+        fBinEnergies = {energy, energy};
+        fBinWeights = {0., 1.};
+    }
+
+    // sub bins with equal weight, bin i covers (E[i-1], E[i]]
+    fEnergies.clear();
+    fWeights.clear();
+    fBinIndex.clear();
+    for (std::size_t i = 1; i < fBinEnergies.size(); ++i) {
+        G4double low = fBinEnergies[i-1];
+        G4double width = fBinEnergies[i] - low;
+        if (fBinWeights[i] <= 0 || width < 0) continue;
+        int nSub = width > 0 ? fNSub : 1;
+        for (int j = 0; j < nSub; ++j) {
+            G4double energy = width > 0 ? low + (j + 0.5)*width/nSub : low;
+            if (energy <= 0) continue;
+            fEnergies.push_back(energy);
+            fWeights.push_back(fBinWeights[i]/nSub);
+            fBinIndex.push_back(i);
+        }
+    }
+}
+
+G4double FastTransmissionModel::PolarizedComptonCrossSection(G4double energy) {
+    // Tolhoek: sigma = sigma0 + Pgamma*Pe*sigmaC with k = E/(m c^2)
+    G4double k = energy/electron_mass_c2;
+    G4double k2 = 1. + 2.*k;
+    return twopi*classic_electr_radius*classic_electr_radius/k
+           *((1. + 4.*k + 5.*k*k)/(k2*k2) - (1. + k)/(2.*k)*std::log(k2));
+}
+
+void FastTransmissionModel::ComputeCrossSections() {
+    // attenuation from the gamma processes of the EM physics of PhysicsList, by name:
+    // the process list holds the biasing wrappers (or the general gamma process) instead
+    std::vector<G4String> processNames = {"phot", "compt", "conv", "Rayl"};
+    if (fConfig.GetConfigValueAsInt("PhysicsList", "polarizationStatus") == 1) {
+        processNames = {"pol-phot", "pol-compt", "pol-conv"}; // PhysListEmPolarized, no Rayleigh
+    }
+    G4EmCalculator calculator;
+    G4ParticleDefinition* gamma = G4Gamma::Gamma();
+    G4double electronDensity = fCoreMaterial->GetElectronDensity();
+
+    fMu.assign(fEnergies.size(), 0.);
+    fMuPol.assign(fEnergies.size(), 0.);
+    for (const auto& processName : processNames) {
+        for (std::size_t j = 0; j < fEnergies.size(); ++j) {
+            fMu[j] += calculator.ComputeCrossSectionPerVolume(fEnergies[j]*MeV, gamma, processName, fCoreMaterial)*mm;
+        }
+    }
+    for (std::size_t j = 0; j < fEnergies.size(); ++j) {
+        if (fMu[j] <= 0.) {
+            G4cout << "----> fastscan: no attenuation at " << fEnergies[j] << " MeV, the transmission there is wrong" << G4endl;
+        }
+        fMuPol[j] = electronDensity*PolarizedComptonCrossSection(fEnergies[j]*MeV)*mm;
+    }
+}
+
+G4double FastTransmissionModel::GetAcceptance(G4double coreRad) const {
+    // fraction of the beam spot inside the core, the rest hits the lead shielding
+    std::string posType = fConfig.GetConfigValue("GPS", "posType");
+    G4double spotSize = fConfig.GetConfigValueAsDouble("GPS", "spotSize");
+    if (spotSize <= 0) return 1.;
+    if (posType == "Plane") {
+        return std::min(1., coreRad*coreRad/(spotSize*spotSize));
+    } else if (posType == "Square") {
+        return std::min(1., pi*coreRad*coreRad/(4.*spotSize*spotSize));
+    }
+    return 1. - std::exp(-coreRad*coreRad/(2.*spotSize*spotSize));
+}
+
+void FastTransmissionModel::RunScan() {
+    ReadSpectrum();
+    if (fEnergies.empty()) {
+        G4cerr << "fastscan: no input spectrum" << G4endl;
+        return;
+    }
+    ComputeCrossSections();
+
+    fPoints.clear();
+    for (G4double coreLength : ReadList("coreLength", fConfig.GetConfigValueAsDouble("Solenoid", "coreLength"))) {
+        for (G4double coreRad : ReadList("coreRad", fConfig.GetConfigValueAsDouble("Solenoid", "coreRad"))) {
+            for (G4double polDeg : ReadList("polDeg", fConfig.GetConfigValueAsDouble("Solenoid", "polDeg"))) {
+                for (G4double Bz : ReadList("Bz", fConfig.GetConfigValueAsDouble("Solenoid", "Bz"))) {
+                    ScanPoint point{coreLength, coreRad, polDeg, Bz};
+                    fPoints.push_back(point);
+                }
+            }
+        }
+    }
+
+    std::ofstream scanFile("fastscan_" + fFileName + ".txt");
+    std::ofstream spectraFile("fastscan_" + fFileName + "_spectra.txt");
+    scanFile << "# point coreLength coreRad polDeg Bz acceptance tPlus tMinus asymN asymE" << G4endl;
+    spectraFile << "# point E weight transmittedPlus transmittedMinus" << G4endl;
+
+    G4double total = 0., totalE = 0.;
+    for (std::size_t j = 0; j < fEnergies.size(); ++j) {
+        total += fWeights[j];
+        totalE += fWeights[j]*fEnergies[j];
+    }
+    for (std::size_t p = 0; p < fPoints.size(); ++p) {
+        ScanPoint& point = fPoints[p];
+        point.acceptance = GetAcceptance(point.coreRad);
+        std::vector<G4double> binPlus(fBinEnergies.size(), 0.), binMinus(fBinEnergies.size(), 0.);
+        G4double nPlus = 0., nMinus = 0., ePlus = 0., eMinus = 0.;
+        for (std::size_t j = 0; j < fEnergies.size(); ++j) {
+            G4double attenuation = point.acceptance*std::exp(-point.coreLength*fMu[j]);
+            G4double spin = point.coreLength*fMuPol[j]*fPhotonPol*point.polDeg;
+            G4double tPlus = fWeights[j]*attenuation*std::exp(-spin);
+            G4double tMinus = fWeights[j]*attenuation*std::exp(spin);
+            nPlus += tPlus;
+            nMinus += tMinus;
+            ePlus += tPlus*fEnergies[j];
+            eMinus += tMinus*fEnergies[j];
+            binPlus[fBinIndex[j]] += tPlus;
+            binMinus[fBinIndex[j]] += tMinus;
+        }
+        point.tPlus = nPlus/total;
+        point.tMinus = nMinus/total;
+        point.asymN = nPlus + nMinus > 0 ? (nPlus - nMinus)/(nPlus + nMinus) : 0.;
+        point.asymE = ePlus + eMinus > 0 ? (ePlus - eMinus)/(ePlus + eMinus) : 0.;
+
+        scanFile << p << " " << point.coreLength << " " << point.coreRad << " " << point.polDeg << " " << point.Bz << " "
+                 << point.acceptance << " " << point.tPlus << " " << point.tMinus << " "
+                 << point.asymN << " " << point.asymE << G4endl;
+        for (std::size_t i = 1; i < fBinEnergies.size(); ++i) {
+            spectraFile << p << " " << fBinEnergies[i] << " " << fBinWeights[i] << " "
+                        << binPlus[i] << " " << binMinus[i] << G4endl;
+        }
+        G4cout << "----> fastscan point " << p << ": coreLength " << point.coreLength << " mm, polDeg " << point.polDeg
+               << ", transmission " << point.tPlus << " / " << point.tMinus << ", asymmetry (E weighted) " << point.asymE << G4endl;
+    }
+    G4cout << "----> fastscan: " << fPoints.size() << " points, mean photon energy " << totalE/total << " MeV" << G4endl;
+}
+
+std::vector<FastTransmissionModel::ScanPoint> FastTransmissionModel::GetCrossCheckPoints() const {
+    std::vector<ScanPoint> points;
+    std::istringstream iss(fConfig.GetConfigValue("FastScan", "crossCheckPoints"));
+    std::size_t index;
+    while (iss >> index) {
+        if (index >= fPoints.size()) {
+            G4cout << "fastscan: cross-check point " << index << " does not exist" << G4endl;
+            continue;
+        }
+        const ScanPoint& point = fPoints[index];
+        if (point.coreLength != fConfig.GetConfigValueAsDouble("Solenoid", "coreLength")
+            || point.coreRad != fConfig.GetConfigValueAsDouble("Solenoid", "coreRad")) {
+            G4cout << "fastscan: cross-check point " << index << " needs another core geometry than [Solenoid], skipped" << G4endl;
+            continue;
+        }
+        points.push_back(point);
+    }
+    return points;
+}
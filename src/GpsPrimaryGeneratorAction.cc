@@ -32,6 +32,9 @@
 #include "G4Event.hh"
 #include "G4GeneralParticleSource.hh"
 #include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
 
 
 namespace leap
@@ -39,9 +42,26 @@ namespace leap
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-GpsPrimaryGeneratorAction::GpsPrimaryGeneratorAction()
+GpsPrimaryGeneratorAction::GpsPrimaryGeneratorAction(const ConfigReader& config)
 {
   fGeneralParticleSource  = new G4GeneralParticleSource();
+
+  fPairedStatus = config.ReadPairedStatus();
+  if (fPairedStatus) {
+    fSeed1 = config.GetConfigValueAsInt("RandomSeeds","rndsds1");
+    fSeed2 = config.GetConfigValueAsInt("RandomSeeds","rndsds2");
+    G4cout << "----> Paired runs: events are seeded from the event ID (common random numbers)" << G4endl;
+  }
+
+  fNBunch = config.ReadNBunch();
+  fNChunks = config.ReadBunchChunks();
+  fStreamSize = config.ReadStreamSize();
+  if (fStreamSize > 0) {
+    G4cout << "----> Primaries are injected in groups of " << fStreamSize << G4endl;
+  }
+  if (fNChunks > 1) {
+    G4cout << "----> Every bunch of " << fNBunch << " primaries is split into " << fNChunks << " events" << G4endl;
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -57,10 +77,49 @@ void GpsPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
   // this function is called at the begining of event
 
+  if (fEventIDOffset) {
+    anEvent->SetEventID(anEvent->GetEventID() + fEventIDOffset);
+  }
+
+  if (fPairedStatus) {
+    // the MixMax engine turns the four seeds into a unique stream -> same
+    // event ID gives the same random numbers in both runs. Without the number
+    // of seeds only the first two would be used
+    long seeds[4] = {fSeed1, fSeed2, anEvent->GetEventID()+1, 1};
+    G4Random::setTheSeeds(seeds, 4);
+  }
+
+  G4int nPrimaries = fNBunch;
+  if (fNChunks > 1) {
+    // the first nBunch % nChunks chunks of a bunch get one primary more
+    G4int chunk = anEvent->GetEventID() % fNChunks;
+    nPrimaries = fNBunch/fNChunks + (chunk < fNBunch % fNChunks ? 1 : 0);
+    fGeneralParticleSource->SetNumberOfParticles(nPrimaries);
+  }
+
+  // the number is always set, the last group of the previous event changed it
+  fRemaining = 0;
+  if (fStreamSize > 0) {
+    fRemaining = std::max(nPrimaries - fStreamSize, 0);
+    fGeneralParticleSource->SetNumberOfParticles(nPrimaries - fRemaining);
+  }
+
   fGeneralParticleSource->GeneratePrimaryVertex(anEvent);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+G4int GpsPrimaryGeneratorAction::GenerateStreamChunk(G4Event* event)
+{
+  G4int nPrimaries = std::min(fStreamSize, fRemaining);
+  if (nPrimaries <= 0) return 0;
+  fGeneralParticleSource->SetNumberOfParticles(nPrimaries);
+  fGeneralParticleSource->GeneratePrimaryVertex(event);
+  fRemaining -= nPrimaries;
+  return nPrimaries;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 }
 
@@ -0,0 +1,61 @@
+// ImportanceParallelWorld.cc
+#include "ImportanceParallelWorld.hh"
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4IStore.hh"
+#include "G4GeometryCell.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+
+ImportanceParallelWorld::ImportanceParallelWorld(const ConfigReader& config)
+  : G4VUserParallelWorld(GetWorldName()) {
+    fZMin = config.GetConfigValueAsDouble("Importance", "zMin")*mm;
+    fZMax = config.GetConfigValueAsDouble("Importance", "zMax")*mm;
+    fNCells = config.ReadIntOrDefault("Importance", "nCells", 1);
+    fRatio = 2.;
+    if (!config.GetConfigValue("Importance", "ratio").empty()) {
+        fRatio = config.GetConfigValueAsDouble("Importance", "ratio");
+    }
+}
+
+ImportanceParallelWorld::~ImportanceParallelWorld() {}
+
+const G4String& ImportanceParallelWorld::GetWorldName() {
+    static const G4String name = "ImportanceWorld";
+    return name;
+}
+
+void ImportanceParallelWorld::Construct() {
+    G4VPhysicalVolume* ghostWorld = GetWorld();
+    G4LogicalVolume* logicWorld = ghostWorld->GetLogicalVolume();
+    // the slabs cover the full cross section of the (box shaped) world
+    auto worldBox = static_cast<G4Box*>(logicWorld->GetSolid());
+    G4double halfXY = std::min(worldBox->GetXHalfLength(), worldBox->GetYHalfLength());
+    G4double worldEnd = worldBox->GetZHalfLength();
+
+    // every volume of the parallel world needs an importance, the world itself has 1
+    G4IStore* iStore = G4IStore::GetInstance(GetWorldName());
+    iStore->AddImportanceGeometryCell(1, *ghostWorld);
+
+    G4double cellLength = (fZMax - fZMin)/fNCells;
+    for (G4int i = 0; i < fNCells; ++i) {
+        G4double zLow = fZMin + i*cellLength;
+        G4double zHigh = i+1 < fNCells ? zLow + cellLength : worldEnd;
+        G4String name = "ImportanceCell_" + std::to_string(i);
+        auto solidCell = new G4Box("solid" + name, halfXY, halfXY, (zHigh - zLow)/2.);
+        auto logicCell = new G4LogicalVolume(solidCell, nullptr, "logic" + name);
+        auto physCell = new G4PVPlacement(nullptr,
+                                          G4ThreeVector(0., 0., (zLow + zHigh)/2.),
+                                          logicCell,
+                                          name,
+                                          logicWorld,
+                                          false,
+                                          i);
+        G4double importance = std::pow(fRatio, i + 1);
+        iStore->AddImportanceGeometryCell(importance, *physCell, i);
+        G4cout << name << ": z from " << zLow << " to " << zHigh << " mm, importance " << importance << G4endl;
+    }
+}
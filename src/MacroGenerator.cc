@@ -1,6 +1,7 @@
 #include "MacroGenerator.hh"
 #include "ConfigReader.hh"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -38,10 +39,20 @@ void MacroGenerator::generateMacro(const ConfigReader& config, const std::string
     macroFile <<"/process/eLoss/StepFunction" << " 0.2 0.01 mm" << std::endl;
 
     // gps commands -------------------------------------------------------------------------------
-    int nBunch = config.GetConfigValueAsInt("GPS","nBunch");
-    macroFile <<"/gps/number " << nBunch << std::endl;
+    // with nChunks > 1 the number of primaries is set per event by the primary generator
+    std::string runType = config.GetConfigValue("Run","type");
+    int nBunch = config.ReadNBunch();
+    int nChunks = config.ReadBunchChunks();
+    macroFile <<"/gps/number " << nBunch/nChunks << std::endl;
 
+    // the response runs use single photons
     std::string particle = config.GetConfigValue("GPS","particle");
+    if (runType == "response") {
+        if (particle != "gamma" || config.ReadIntOrDefault("GPS","nBunch",1) != 1) {
+            G4cout << "----> The response runs use single photons, [GPS] particle and nBunch are not used" << G4endl;
+        }
+        particle = "gamma";
+    }
     macroFile <<"/gps/particle " << particle << std::endl;
 
     std::string position = config.GetConfigValue("GPS","position");
@@ -75,7 +86,8 @@ void MacroGenerator::generateMacro(const ConfigReader& config, const std::string
     macroFile << "/gps/ang/rot1 0 1 0"<< std::endl;
     macroFile << "/gps/ang/rot2 1 0 0"<< std::endl;
 
-    std::string eneType = config.GetConfigValue("GPS", "eneType");
+    // the response runs use monoenergetic photons, the energies are set per run below
+    std::string eneType = runType == "response" ? "Mono" : config.GetConfigValue("GPS", "eneType");
     macroFile << "/gps/ene/type " << eneType <<std::endl;
 
     std::string energy;
@@ -95,8 +107,16 @@ void MacroGenerator::generateMacro(const ConfigReader& config, const std::string
         macroFile << "/control/execute " << histname << std::endl;
     }
 
-    std::string runType = config.GetConfigValue("Run","type");
     std::string Nevents = config.GetConfigValue("Run","Nevents");
+    // with a target precision the runs are started with the maximum number of
+    // events and stopped by the online asymmetry estimate
+    if (config.ReadAsymPrecision() > 0 && !config.GetConfigValue("Run","maxEvents").empty()) {
+        Nevents = config.GetConfigValue("Run","maxEvents");
+    }
+    // Nevents counts bunches, every bunch takes nChunks events
+    if (nChunks > 1) {
+        Nevents = std::to_string(std::stol(Nevents)*nChunks);
+    }
     double polDeg = config.GetConfigValueAsDouble("GPS","polDeg"); 
     std::string Bz = config.GetConfigValue("Solenoid","Bz");
     double polDegSol = config.GetConfigValueAsDouble("Solenoid","polDeg");
@@ -141,10 +161,126 @@ void MacroGenerator::generateMacro(const ConfigReader& config, const std::string
         
         
 
+    } else if (runType=="response"){
+        // two runs per energy of the grid, first with the positive then with the negative polarization,
+        // the run ID is 2*(index of the energy) + (0 for positive, 1 for negative)
+        bool flipCore = flip=="core" && solenoidStatus==1 &&( Bstat==1 || polDegSol>0.0);
+        for (double energy : config.ReadResponseEnergies()){
+            macroFile << "/gps/ene/mono " << energy << " MeV" << std::endl;
+            for (int sign : {1, -1}){
+                std::string signStr = sign > 0 ? "" : "-";
+                if (flipCore){
+                    if (polDeg != 0){
+                        macroFile << "/gps/polarization 0. 0. " << std::to_string(polDeg) << std::endl;
+                    }
+                    if (Bstat){
+                        macroFile << "/solenoid/setBz " << signStr << Bz << std::endl;
+                    }
+                    if (polDegSol>0.0){
+                        macroFile << "/polarization/volume/set logicCore 0. 0. " << signStr << std::to_string(polDegSol) << std::endl;
+                    }
+                } else {
+                    macroFile << "/gps/polarization 0. 0. " << signStr << std::to_string(polDeg) << std::endl;
+                }
+                macroFile << "/run/beamOn " << Nevents << std::endl;
+            }
+        }
+
+    } else if (runType=="fastscan"){
+        // only builds the physics tables for the transmission model, no events
+        macroFile << "/run/beamOn 0" << std::endl;
+
     } else {
         // single run with N events  
         macroFile << "/run/beamOn " << Nevents << std::endl;
     } 
     // Close the file
     macroFile.close();
-}
\ No newline at end of file
+}
+void MacroGenerator::generateCrossCheckMacro(const ConfigReader& config, const std::vector<FastTransmissionModel::ScanPoint>& points, const std::string& tempMacroFilename) {
+    std::ofstream macroFile(tempMacroFilename);
+    if (!macroFile.is_open()) {
+        G4cerr << "Could not open macro file " << tempMacroFilename << " for writing." << G4endl;
+        return;
+    }
+    // full simulation of the chosen scan points, two runs per point with the core
+    // polarization and field first positive then negative, run ID 2*point + sign
+    std::string Nevents = std::to_string(long(config.ReadCrossCheckEvents())*config.ReadBunchChunks());
+    double polDeg = config.GetConfigValueAsDouble("GPS","polDeg");
+    auto Bstat = config.GetConfigValueAsInt("Solenoid","BField");
+    if (polDeg != 0){
+        macroFile << "/gps/polarization 0. 0. " << std::to_string(polDeg) << std::endl;
+    }
+    for (const auto& point : points){
+        for (int sign : {1, -1}){
+            if (Bstat){
+                macroFile << "/solenoid/setBz " << std::to_string(sign*point.Bz) << std::endl;
+            }
+            macroFile << "/polarization/volume/set logicCore 0. 0. " << std::to_string(sign*point.polDeg) << std::endl;
+            macroFile << "/run/beamOn " << Nevents << std::endl;
+        }
+    }
+    macroFile.close();
+}
+int MacroGenerator::generateWorkerMacros(const ConfigReader& config, const std::string& tempMacroFilename, int& nWorkers, std::vector<long>& firstEvents, long& eventsPerJob) {
+    std::ifstream macroFile(tempMacroFilename);
+    if (!macroFile.is_open()) {
+        G4cerr << "Could not open macro file " << tempMacroFilename << " for reading." << G4endl;
+        return 0;
+    }
+    std::vector<std::string> setup, runs;
+    long Nevents = -1;
+    std::string line;
+    while (std::getline(macroFile, line)) {
+        if (Nevents < 0 && line.rfind("/run/beamOn", 0) == 0) {
+            std::istringstream iss(line.substr(11));
+            iss >> Nevents;
+        }
+        (Nevents < 0 ? setup : runs).push_back(line);
+    }
+    if (Nevents <= 0) {
+        G4cerr << "No run in macro file " << tempMacroFilename << G4endl;
+        return 0;
+    }
+
+    // the events are split in whole bunches (nChunks) and whole blocks, the
+    // remaining events of an incomplete last block go to the last worker
+    long unit = std::max(config.ReadBlockSize(), config.ReadBunchChunks());
+    long nUnits = Nevents/unit;
+    nWorkers = int(std::max(1L, std::min(long(nWorkers), nUnits)));
+    firstEvents.clear();
+    std::vector<long> nEvents;
+    long first = 0;
+    for (int i = 0; i < nWorkers; ++i) {
+        long n = (nUnits/nWorkers + (i < nUnits % nWorkers ? 1 : 0))*unit;
+        if (i == nWorkers - 1) n += Nevents % unit;
+        firstEvents.push_back(first);
+        nEvents.push_back(n);
+        first += n;
+    }
+    // event IDs per job of a split production, whole units so that every job
+    // starts with a new block and bunch
+    eventsPerJob = (Nevents + unit - 1)/unit*unit;
+
+    std::string base = tempMacroFilename.substr(0, tempMacroFilename.rfind(".mac"));
+    std::ofstream setupFile(base + "_setup.mac");
+    for (const auto& setupLine : setup) {
+        setupFile << setupLine << std::endl;
+    }
+    setupFile << "/run/beamOn 0" << std::endl;
+
+    int nRuns = 0;
+    for (int i = 0; i < nWorkers; ++i) {
+        std::ofstream workerFile(base + "_w" + std::to_string(i) + ".mac");
+        nRuns = 0;
+        for (const auto& runLine : runs) {
+            if (runLine.rfind("/run/beamOn", 0) == 0) {
+                workerFile << "/run/beamOn " << nEvents[i] << std::endl;
+                nRuns += 1;
+            } else {
+                workerFile << runLine << std::endl;
+            }
+        }
+    }
+    return nRuns;
+}
@@ -0,0 +1,337 @@
+// OutputMerger.cc
+#include "OutputMerger.hh"
+
+#include "G4AnalysisManager.hh"
+#include "G4RootAnalysisReader.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+OutputMerger::OutputMerger(const ConfigReader& config)
+  : fConfig(config),
+    fOutputMode(config.ReadOutputMode()),
+    fTreesInfo(config.ReadTreesInfo()),
+    fHistoInfo(config.ReadHistoInfo()) {
+}
+
+OutputMerger::~OutputMerger() {}
+
+bool OutputMerger::IsHitTuple(const std::string& treeName) const {
+    // one row per hit (or per event in the vector layout), also in SumRun
+    int showerDev = fConfig.ReadShowerDevStat();
+    return fOutputMode == "detailed" || (treeName == "CaloCrystal" && (showerDev == 1 || showerDev == 3));
+}
+
+std::vector<OutputMerger::MergeColumn> OutputMerger::GetColumns(const std::string& treeName) const {
+    // same layout as AnaConfigManager::BookNtuples and BookHitVectors
+    bool vectorLayout = IsHitTuple(treeName) && fConfig.ReadDetailedLayout() == "vector";
+    std::vector<MergeColumn> columns;
+    for (const auto& branchInfo : fConfig.GetBranchesInfo(treeName)) {
+        if (vectorLayout && branchInfo.name != "EventID") {
+            if (branchInfo.type == "S") continue; // not booked in the vector layout
+            columns.push_back({branchInfo.name, branchInfo.type, true});
+        } else {
+            columns.push_back({branchInfo.name, branchInfo.type, false});
+        }
+    }
+    return columns;
+}
+
+bool OutputMerger::ReadMetadata(const std::string& inFile, Metadata& metadata) const {
+    G4RootAnalysisReader* reader = G4RootAnalysisReader::Instance();
+    G4int ntupleID = reader->GetNtuple("Metadata", inFile);
+    if (ntupleID < 0) {
+        G4cerr << "No Metadata tree in " << inFile << G4endl;
+        return false;
+    }
+    G4String key, value;
+    reader->SetNtupleSColumn(ntupleID, "Key", key);
+    reader->SetNtupleSColumn(ntupleID, "Value", value);
+    while (reader->GetNtupleRow(ntupleID)) {
+        metadata.push_back(std::make_pair(key, value));
+    }
+    return true;
+}
+
+bool OutputMerger::IsConfigKey(const std::string& key) const {
+    // results, jobs, seeds and file names differ between the files of one production
+    for (const std::string prefix : {"Result.", "Job.", "Merge.", "RandomSeeds."}) {
+        if (key.rfind(prefix, 0) == 0) return false;
+    }
+    return key != "Output.fileName";
+}
+
+bool OutputMerger::CheckMetadata(const std::vector<std::string>& inFiles, const std::vector<Metadata>& metadata) const {
+    std::map<std::string, std::string> reference;
+    for (const auto& kv : metadata[0]) {
+        if (IsConfigKey(kv.first)) reference[kv.first] = kv.second;
+    }
+    bool consistent = true;
+    for (std::size_t i = 1; i < metadata.size(); ++i) {
+        std::map<std::string, std::string> config;
+        for (const auto& kv : metadata[i]) {
+            if (IsConfigKey(kv.first)) config[kv.first] = kv.second;
+        }
+        for (const auto& kv : reference) {
+            auto it = config.find(kv.first);
+            if (it == config.end() || it->second != kv.second) {
+                G4cerr << inFiles[i] << ": " << kv.first << " = " << (it == config.end() ? "(missing)" : it->second)
+                       << ", " << inFiles[0] << ": " << kv.second << G4endl;
+                consistent = false;
+            }
+        }
+        for (const auto& kv : config) {
+            if (reference.find(kv.first) == reference.end()) {
+                G4cerr << inFiles[i] << ": " << kv.first << " is missing in " << inFiles[0] << G4endl;
+                consistent = false;
+            }
+        }
+    }
+    return consistent;
+}
+
+void OutputMerger::BookTree(const TreeInfo& treeInfo) {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    TreeBuffers& buffers = fBuffers[treeInfo.id];
+    buffers.columns = GetColumns(treeInfo.name);
+    std::size_t nColumns = buffers.columns.size();
+    // the columns are bound to the buffers, so these must not be resized after booking
+    buffers.valuesD.assign(nColumns, 0.);
+    buffers.valuesI.assign(nColumns, 0);
+    buffers.valuesS.assign(nColumns, "");
+    buffers.vectorsF.assign(nColumns, std::vector<G4float>());
+    buffers.vectorsI.assign(nColumns, std::vector<G4int>());
+    buffers.rowSums.clear();
+
+    analysisManager->CreateNtuple(treeInfo.name, treeInfo.title);
+    for (std::size_t i = 0; i < nColumns; ++i) {
+        const MergeColumn& column = buffers.columns[i];
+        if (column.isVector && column.type == "D") {
+            analysisManager->CreateNtupleFColumn(treeInfo.id, column.name, buffers.vectorsF[i]);
+        } else if (column.isVector) {
+            analysisManager->CreateNtupleIColumn(treeInfo.id, column.name, buffers.vectorsI[i]);
+        } else if (column.type == "D") {
+            analysisManager->CreateNtupleDColumn(treeInfo.id, column.name);
+        } else if (column.type == "I") {
+            analysisManager->CreateNtupleIColumn(treeInfo.id, column.name);
+        } else {
+            analysisManager->CreateNtupleSColumn(treeInfo.id, column.name);
+        }
+    }
+    analysisManager->FinishNtuple(treeInfo.id);
+}
+
+long OutputMerger::MergeTree(const TreeInfo& treeInfo, const std::string& inFile) {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    G4RootAnalysisReader* reader = G4RootAnalysisReader::Instance();
+    G4int ntupleID = reader->GetNtuple(treeInfo.name, inFile);
+    if (ntupleID < 0) {
+        G4cerr << "No " << treeInfo.name << " tree in " << inFile << G4endl;
+        return -1;
+    }
+    TreeBuffers& buffers = fBuffers[treeInfo.id];
+    std::size_t nColumns = buffers.columns.size();
+    for (std::size_t i = 0; i < nColumns; ++i) {
+        const MergeColumn& column = buffers.columns[i];
+        if (column.isVector && column.type == "D") {
+            reader->SetNtupleFColumn(ntupleID, column.name, buffers.vectorsF[i]);
+        } else if (column.isVector) {
+            reader->SetNtupleIColumn(ntupleID, column.name, buffers.vectorsI[i]);
+        } else if (column.type == "D") {
+            reader->SetNtupleDColumn(ntupleID, column.name, buffers.valuesD[i]);
+        } else if (column.type == "I") {
+            reader->SetNtupleIColumn(ntupleID, column.name, buffers.valuesI[i]);
+        } else {
+            reader->SetNtupleSColumn(ntupleID, column.name, buffers.valuesS[i]);
+        }
+    }
+
+    // one row at a time, only the SumRun sums keep their rows until all files are read
+    bool sumRows = fOutputMode == "SumRun" && !IsHitTuple(treeInfo.name);
+    long nRows = 0;
+    while (reader->GetNtupleRow(ntupleID)) {
+        if (sumRows) {
+            if (nRows >= (long)buffers.rowSums.size()) {
+                buffers.rowSums.push_back(std::vector<G4double>(nColumns, 0.));
+            }
+            for (std::size_t i = 0; i < nColumns; ++i) {
+                buffers.rowSums[nRows][i] += buffers.columns[i].type == "I" ? buffers.valuesI[i] : buffers.valuesD[i];
+            }
+        } else {
+            for (std::size_t i = 0; i < nColumns; ++i) {
+                const MergeColumn& column = buffers.columns[i];
+                if (column.isVector) continue; // bound to the output
+                if (column.type == "D") {
+                    analysisManager->FillNtupleDColumn(treeInfo.id, i, buffers.valuesD[i]);
+                } else if (column.type == "I") {
+                    analysisManager->FillNtupleIColumn(treeInfo.id, i, buffers.valuesI[i]);
+                } else {
+                    analysisManager->FillNtupleSColumn(treeInfo.id, i, buffers.valuesS[i]);
+                }
+            }
+            analysisManager->AddNtupleRow(treeInfo.id);
+        }
+        nRows += 1;
+    }
+    return nRows;
+}
+
+void OutputMerger::WriteSumRows(const TreeInfo& treeInfo) {
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    TreeBuffers& buffers = fBuffers[treeInfo.id];
+    for (const auto& row : buffers.rowSums) {
+        for (std::size_t i = 0; i < buffers.columns.size(); ++i) {
+            if (buffers.columns[i].type == "I") {
+                analysisManager->FillNtupleIColumn(treeInfo.id, i, G4int(row[i]));
+            } else {
+                analysisManager->FillNtupleDColumn(treeInfo.id, i, row[i]);
+            }
+        }
+        analysisManager->AddNtupleRow(treeInfo.id);
+    }
+}
+
+void OutputMerger::MergeHistos(const std::string& inFile) {
+    // the binning of the output histograms is the one of the first file which has them
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    G4RootAnalysisReader* reader = G4RootAnalysisReader::Instance();
+    for (std::size_t j = 0; j < fHistoInfo.size(); ++j) {
+        const std::string& name = fHistoInfo[j].title;
+        G4int h1ID = reader->ReadH1(name, inFile);
+        tools::histo::h1d* h1 = h1ID >= 0 ? reader->GetH1(h1ID) : nullptr;
+        G4int h2ID = reader->ReadH2(name, inFile);
+        tools::histo::h2d* h2 = h2ID >= 0 ? reader->GetH2(h2ID) : nullptr;
+        if (!h1 || !h2) {
+            G4cerr << "Histograms " << name << " missing in " << inFile << G4endl;
+            continue;
+        }
+        if (fH1IDs[j] < 0) {
+            fH1IDs[j] = analysisManager->CreateH1(name, "E_tot_spec", h1->axis().bins(),
+                                                  h1->axis().lower_edge(), h1->axis().upper_edge());
+            fH2IDs[j] = analysisManager->CreateH2(name, "Beam Profile",
+                                                  h2->x_axis().bins(), h2->x_axis().lower_edge(), h2->x_axis().upper_edge(),
+                                                  h2->y_axis().bins(), h2->y_axis().lower_edge(), h2->y_axis().upper_edge());
+        }
+        if (!analysisManager->GetH1(fH1IDs[j])->add(*h1)
+            || !analysisManager->GetH2(fH2IDs[j])->add(*h2)) {
+            G4cerr << "Histograms " << name << " of " << inFile << " have a different binning, skipped" << G4endl;
+        }
+    }
+}
+
+bool OutputMerger::Merge(const std::vector<std::string>& inFiles, const std::string& outFile) {
+    if (inFiles.empty()) return false;
+    if (fOutputMode == "stats") {
+        G4cerr << "stats outputs hold moments and are not merged" << G4endl;
+        return false;
+    }
+    G4RootAnalysisReader* reader = G4RootAnalysisReader::Instance();
+    reader->SetVerboseLevel(0);
+
+    // configurations first, nothing is written if they differ
+    std::vector<Metadata> metadata(inFiles.size());
+    for (std::size_t i = 0; i < inFiles.size(); ++i) {
+        if (!ReadMetadata(inFiles[i], metadata[i])) return false;
+        reader->CloseFiles();
+    }
+    if (!CheckMetadata(inFiles, metadata)) {
+        if (fCheckConfig) {
+            G4cerr << "The configurations of the files differ, " << outFile << " is not written" << G4endl;
+            return false;
+        }
+        G4cout << "The configurations of the files differ, merged anyway" << G4endl;
+    }
+
+    G4AnalysisManager* analysisManager = G4AnalysisManager::Instance();
+    analysisManager->SetDefaultFileType("root");
+    analysisManager->SetVerboseLevel(0);
+    analysisManager->OpenFile(outFile);
+    for (const auto& treeInfo : fTreesInfo) {
+        BookTree(treeInfo);
+    }
+    fH1IDs.assign(fHistoInfo.size(), -1);
+    fH2IDs.assign(fHistoInfo.size(), -1);
+
+    bool merged = true;
+    for (std::size_t i = 0; i < inFiles.size(); ++i) {
+        for (const auto& treeInfo : fTreesInfo) {
+            if (MergeTree(treeInfo, inFiles[i]) < 0) merged = false;
+        }
+        MergeHistos(inFiles[i]);
+        // every file is closed before the next one is opened
+        reader->CloseFiles();
+    }
+    if (fOutputMode == "SumRun") {
+        for (const auto& treeInfo : fTreesInfo) {
+            WriteSumRows(treeInfo);
+        }
+    }
+
+    // configuration once, the results and job keys of every input file after its name
+    int tupleID = analysisManager->CreateNtuple("Metadata", "Configuration Metadata");
+    analysisManager->CreateNtupleSColumn(tupleID, "Key");
+    analysisManager->CreateNtupleSColumn(tupleID, "Value");
+    analysisManager->FinishNtuple(tupleID);
+    auto addRow = [&](const std::string& key, const std::string& value) {
+        analysisManager->FillNtupleSColumn(tupleID, 0, key);
+        analysisManager->FillNtupleSColumn(tupleID, 1, value);
+        analysisManager->AddNtupleRow(tupleID);
+    };
+    for (const auto& kv : metadata[0]) {
+        if (IsConfigKey(kv.first)) addRow(kv.first, kv.second);
+    }
+    addRow("Merge.nFiles", std::to_string(inFiles.size()));
+    for (std::size_t i = 0; i < inFiles.size(); ++i) {
+        addRow("Merge.file", inFiles[i]);
+        for (const auto& kv : metadata[i]) {
+            if (!IsConfigKey(kv.first)) addRow(kv.first, kv.second);
+        }
+    }
+
+    analysisManager->Write();
+    analysisManager->CloseFile();
+    G4cout << "----> Merged " << inFiles.size() << " files into " << outFile << G4endl;
+    return merged;
+}
+
+bool OutputMerger::MergeGroups(const ConfigReader& config, const std::map<std::string, std::vector<std::string>>& groups,
+                               int nProcesses, bool checkConfig) {
+    // one process per output file, the analysis manager and reader are singletons
+    bool merged = true;
+    std::map<pid_t, std::string> running;
+    auto waitForOne = [&]() {
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid <= 0) return;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            G4cerr << "Merging " << running[pid] << " failed" << G4endl;
+            merged = false;
+        }
+        running.erase(pid);
+    };
+    for (const auto& group : groups) {
+        while ((int)running.size() >= std::max(1, nProcesses)) {
+            waitForOne();
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            OutputMerger merger(config);
+            merger.SetCheckConfig(checkConfig);
+            bool ok = merger.Merge(group.second, group.first);
+            std::cout.flush();
+            _exit(ok ? 0 : 1);
+        }
+        if (pid < 0) {
+            G4cerr << "Could not start the merging of " << group.first << G4endl;
+            merged = false;
+            continue;
+        }
+        running[pid] = group.first;
+    }
+    while (!running.empty()) {
+        waitForOne();
+    }
+    return merged;
+}
@@ -85,6 +85,7 @@ void PhysListOptical::ConstructProcess()
   /* large number of secondaries generated -> track secondaries first to avoid memory issues
    * on the other hand: this screws up counting of secondary electrons if they create
    * optical photons as well: they get suspended and then counted again...
+   * the stack size can be limited with the [Stacking] policy of the StackingAction instead
    */
   theCerenkovProcess->SetTrackSecondariesFirst(false);
 
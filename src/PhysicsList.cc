@@ -4,6 +4,13 @@
 #include "PhysicsList.hh"
 #include "PhysListEmPolarized.hh"
 #include "PhysListOptical.hh"
+#include "ScoringParallelWorld.hh"
+#include "ImportanceParallelWorld.hh"
+#include "G4ParallelWorldPhysics.hh"
+#include "G4GenericBiasingPhysics.hh"
+#include "G4ImportanceBiasing.hh"
+#include "G4GeometrySampler.hh"
+#include "G4TransportationManager.hh"
 #include "G4EmStandardPhysics.hh"
 #include "G4EmStandardPhysics_option4.hh"
 #include "G4EmParameters.hh"
@@ -12,7 +19,7 @@
 
 PhysicsList::PhysicsList(const ConfigReader& config)
 : G4VModularPhysicsList(),fConfig(config),
-  fEmPhysicsList(0), fOptPhysicsList(0)
+  fEmPhysicsList(0), fOptPhysicsList(0), fScoringWorldPhysics(0), fBiasingPhysics(0), fImportanceWorldPhysics(0)
 {
   fPolStatus = config.GetConfigValueAsInt("PhysicsList", "polarizationStatus");
   fOptStatus = config.GetConfigValueAsInt("PhysicsList", "opticalStatus");
@@ -29,6 +36,30 @@ PhysicsList::PhysicsList(const ConfigReader& config)
   
   fOptPhysicsList= new PhysListOptical();
 
+  // navigation in the parallel world of the scoring planes
+  if (!config.ReadScoringPlanes().empty()){
+    fScoringWorldPhysics = new G4ParallelWorldPhysics(ScoringParallelWorld::GetWorldName());
+  }
+
+  // biasing in the iron core: scale wraps only the Compton process, force all gamma processes
+  G4String coreBiasing = config.ReadCoreBiasing();
+  if (coreBiasing != "none"){
+    // the operators need the single processes, not the gamma general process
+    G4EmParameters::Instance()->SetGeneralProcessActive(false);
+    G4GenericBiasingPhysics* biasingPhysics = new G4GenericBiasingPhysics();
+    if (coreBiasing == "scale"){
+      biasingPhysics->PhysicsBias("gamma", {fPolStatus==1 ? "pol-compt" : "compt"});
+    } else {
+      biasingPhysics->Bias("gamma");
+    }
+    fBiasingPhysics = biasingPhysics;
+  }
+
+  // navigation in the parallel world of the importance cells
+  if (config.ReadImportanceStatus()){
+    fImportanceWorldPhysics = new G4ParallelWorldPhysics(ImportanceParallelWorld::GetWorldName());
+  }
+
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -37,6 +68,11 @@ PhysicsList::~PhysicsList()
 {
   delete fEmPhysicsList;
   delete fOptPhysicsList;
+  delete fScoringWorldPhysics;
+  delete fBiasingPhysics;
+  delete fImportanceWorldPhysics;
+  for (auto* physics : fImportancePhysics) delete physics;
+  for (auto* sampler : fImportanceSamplers) delete sampler;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -92,6 +128,32 @@ void PhysicsList::ConstructProcess()
   fOptPhysicsList->ConstructProcess();
   }
 
+  // biasing wrappers around the already constructed gamma processes
+  if(fBiasingPhysics){
+  fBiasingPhysics->ConstructProcess();
+  }
+
+  // splitting and Russian roulette at the boundaries of the importance cells,
+  // the geometry (and with it the parallel world) is already constructed here
+  if(fImportanceWorldPhysics){
+    G4VPhysicalVolume* importanceWorld = G4TransportationManager::GetTransportationManager()
+                                         ->GetParallelWorld(ImportanceParallelWorld::GetWorldName());
+    for (const auto& particle : fConfig.ReadImportanceParticles()){
+      G4GeometrySampler* sampler = new G4GeometrySampler(importanceWorld, particle);
+      sampler->SetParallel(true);
+      G4VPhysicsConstructor* importancePhysics = new G4ImportanceBiasing(sampler, ImportanceParallelWorld::GetWorldName());
+      importancePhysics->ConstructProcess();
+      fImportanceSamplers.push_back(sampler);
+      fImportancePhysics.push_back(importancePhysics);
+    }
+    fImportanceWorldPhysics->ConstructProcess();
+  }
+
+  // scoring planes, the parallel world does not change the materials (no layered mass)
+  if(fScoringWorldPhysics){
+  fScoringWorldPhysics->ConstructProcess();
+  }
+
   // step limitation (as a full process)
   //
   AddStepMax();
@@ -0,0 +1,194 @@
+#include "ResponseMatrix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+ResponseMatrix::ResponseMatrix() {}
+
+ResponseMatrix::~ResponseMatrix() {}
+
+void ResponseMatrix::SetLayout(const std::vector<std::string>& columns, int nBins, double histMax) {
+    fColumns = columns;
+    fNBins = nBins;
+    fHistMax = histMax;
+    fPoints.clear();
+}
+
+void ResponseMatrix::Clear() {
+    fPoints.clear();
+}
+
+void ResponseMatrix::AddPoint(const ResponsePoint& point) {
+    fPoints.push_back(point);
+}
+
+bool ResponseMatrix::Write(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open response file: " << fileName << std::endl;
+        return false;
+    }
+    file.precision(10);
+    file << "# leap_sims response matrix, per incident photon" << std::endl;
+    file << "columns";
+    for (const auto& column : fColumns) file << " " << column;
+    file << std::endl;
+    file << "bins " << fNBins << " 0 " << fHistMax << std::endl;
+    for (const auto& point : fPoints) {
+        file << "point " << point.energy << " " << point.polSign << " " << point.nEvents << std::endl;
+        file << "mean";
+        for (const auto& value : point.mean) file << " " << value;
+        file << std::endl << "variance";
+        for (const auto& value : point.variance) file << " " << value;
+        file << std::endl;
+        for (std::size_t c = 0; c < fColumns.size(); ++c) {
+            file << "hist " << c;
+            for (int b = 0; b < fNBins; ++b) file << " " << point.hist[c*fNBins + b];
+            file << std::endl;
+        }
+    }
+    return true;
+}
+
+bool ResponseMatrix::Read(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open response file: " << fileName << std::endl;
+        return false;
+    }
+    fColumns.clear();
+    fPoints.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+        if (key == "columns") {
+            std::string column;
+            while (iss >> column) fColumns.push_back(column);
+        } else if (key == "bins") {
+            double histMin;
+            iss >> fNBins >> histMin >> fHistMax;
+        } else if (key == "point") {
+            ResponsePoint point;
+            iss >> point.energy >> point.polSign >> point.nEvents;
+            point.hist.assign(fColumns.size()*fNBins, 0.);
+            fPoints.push_back(point);
+        } else if (!fPoints.empty() && (key == "mean" || key == "variance")) {
+            auto& values = key == "mean" ? fPoints.back().mean : fPoints.back().variance;
+            double value;
+            while (iss >> value) values.push_back(value);
+        } else if (!fPoints.empty() && key == "hist") {
+            std::size_t c;
+            iss >> c;
+            for (int b = 0; b < fNBins && c < fColumns.size(); ++b) {
+                iss >> fPoints.back().hist[c*fNBins + b];
+            }
+        }
+        if (iss.fail() && !iss.eof()) {
+            std::cerr << "Failed to parse response file line: " << line << std::endl;
+            return false;
+        }
+    }
+    for (const auto& point : fPoints) {
+        if (point.mean.size() != fColumns.size() || point.variance.size() != fColumns.size()) {
+            std::cerr << "Incomplete response point at " << point.energy << " MeV in " << fileName << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<const ResponsePoint*> ResponseMatrix::GetPoints(int polSign) const {
+    std::vector<const ResponsePoint*> points;
+    for (const auto& point : fPoints) {
+        if (point.polSign == polSign) points.push_back(&point);
+    }
+    return points;
+}
+
+std::vector<double> ResponseMatrix::GetEnergies(int polSign) const {
+    std::vector<double> energies;
+    for (const auto* point : GetPoints(polSign)) energies.push_back(point->energy);
+    return energies;
+}
+
+int ResponseMatrix::GetColumnIndex(const std::string& name) const {
+    auto it = std::find(fColumns.begin(), fColumns.end(), name);
+    return it == fColumns.end() ? -1 : int(it - fColumns.begin());
+}
+
+std::vector<double> ResponseMatrix::GetSpectrumWeights(int polSign, const std::vector<double>& binEdges,
+                                                       const std::vector<double>& binWeights) const {
+    std::vector<double> energies = GetEnergies(polSign);
+    std::vector<double> weights(energies.size(), 0.);
+    if (energies.empty()) return weights;
+
+    // every grid point stands for the energies up to half way to its neighbours
+    std::vector<double> lower(energies.size()), upper(energies.size());
+    for (std::size_t k = 0; k < energies.size(); ++k) {
+        lower[k] = k == 0 ? 0. : 0.5*(energies[k-1] + energies[k]);
+        upper[k] = k+1 == energies.size() ? 2.*energies[k] - lower[k] : 0.5*(energies[k] + energies[k+1]);
+    }
+    if (energies.size() > 1) {
+        lower[0] = std::max(0., energies[0] - (upper[0] - energies[0]));
+    }
+
+    // the spectrum is flat within its bins, the first point is the lower edge
+    for (std::size_t i = 1; i < binEdges.size() && i < binWeights.size(); ++i) {
+        double a = binEdges[i-1];
+        double b = binEdges[i];
+        if (b <= a || binWeights[i] == 0.) continue;
+        double density = binWeights[i]/(b - a);
+        for (std::size_t k = 0; k < energies.size(); ++k) {
+            double overlap = std::min(b, upper[k]) - std::max(a, lower[k]);
+            if (overlap > 0) weights[k] += density*overlap;
+        }
+    }
+    return weights;
+}
+
+FoldedResponse ResponseMatrix::Fold(int polSign, const std::vector<double>& weights) const {
+    const std::size_t nColumns = fColumns.size();
+    const std::size_t nHist = nColumns*fNBins;
+    FoldedResponse folded;
+    folded.mean.assign(nColumns, 0.);
+    folded.meanError.assign(nColumns, 0.);
+    folded.variance.assign(nColumns, 0.);
+    folded.hist.assign(nHist, 0.);
+
+    std::vector<const ResponsePoint*> points = GetPoints(polSign);
+    std::vector<double> secondMoment(nColumns, 0.);
+    for (std::size_t k = 0; k < points.size() && k < weights.size(); ++k) {
+        const double w = weights[k];
+        if (w == 0.) continue;
+        const ResponsePoint& point = *points[k];
+        folded.norm += w;
+        // the matrix-vector products: response columns weighted with the spectrum
+        const double w2n = point.nEvents > 0 ? w*w/point.nEvents : 0.;
+        for (std::size_t c = 0; c < nColumns; ++c) {
+            folded.mean[c] += w*point.mean[c];
+            secondMoment[c] += w*(point.variance[c] + point.mean[c]*point.mean[c]);
+            folded.meanError[c] += w2n*point.variance[c];
+        }
+        for (std::size_t h = 0; h < nHist; ++h) {
+            folded.hist[h] += w*point.hist[h];
+        }
+    }
+    if (folded.norm <= 0.) return folded;
+
+    const double inv = 1./folded.norm;
+    for (std::size_t c = 0; c < nColumns; ++c) {
+        folded.mean[c] *= inv;
+        folded.variance[c] = secondMoment[c]*inv - folded.mean[c]*folded.mean[c];
+        folded.meanError[c] = std::sqrt(folded.meanError[c])*inv;
+    }
+    for (std::size_t h = 0; h < nHist; ++h) {
+        folded.hist[h] *= inv;
+    }
+    return folded;
+}
@@ -74,8 +74,15 @@ void RunAction::EndOfRunAction(const G4Run* run) {
     G4int NbOfEvents = run->GetNumberOfEvent();
     if (NbOfEvents == 0) return;
 
+    // block mode: the last block of the run can be incomplete
+    G4int blockSize = fAnaConfigManager.GetBlockSize();
+    G4bool openBlock = fOutputMode == "block" && NbOfEvents % blockSize != 0;
+    if (openBlock) {
+        fAnaConfigManager.SetBlockEventCount(NbOfEvents % blockSize);
+    }
+
     //Run Summary 
-     if (fOutputMode == "SumRun") {
+     if (fOutputMode == "SumRun" || openBlock) {
         G4SDManager* sdManager = G4SDManager::GetSDMpointer();
         
         for (const auto& treeInfo : fTreesInfo) {
@@ -83,12 +90,13 @@ void RunAction::EndOfRunAction(const G4Run* run) {
                 CaloFrontSensitiveDetector* mySD = static_cast<CaloFrontSensitiveDetector*>(sdManager->FindSensitiveDetector(treeInfo.name));
                 if (!mySD) continue;
                 std::vector<double> energySum = mySD->GetEnergySum();
-                std::vector<int> Ntot = mySD->GetTotalCount();
+                std::vector<double> Ntot = mySD->GetTotalCount();
                 //G4cout << "CaloFrontSensitiveDetector Address in EventAction: " << mySD << ", Size: " << energySum.size() << G4endl;
                 //G4cout << "-------ooooooooooooo-----------ooooooooooooooooooo---------ooooooooooooooo----- energySum has length " << energySum.size() << G4endl;
                 fAnaConfigManager.FillCaloFrontTuple_summary(mySD->GetTupleID(), Ntot, energySum);
 
             } else if (treeInfo.name == "CaloCrystal" ){
+                if (fAnaConfigManager.HasCrystalHitTuple()) continue;
                 G4SDManager* sdManager = G4SDManager::GetSDMpointer();
                 CaloCrystalSD* mySD = static_cast<CaloCrystalSD*>(sdManager->FindSensitiveDetector(treeInfo.name));
                 if (!mySD) continue;
@@ -101,14 +109,14 @@ void RunAction::EndOfRunAction(const G4Run* run) {
                 if (!mySD) continue;
 
                 G4double energySum = mySD->GetEnergySum();
-                G4int Ntot = mySD->GetTotalCount();
+                G4double Ntot = mySD->GetTotalCount();
                 G4double EgammaSum = mySD->GetGammaEnergySum();
-                G4int Ngamma = mySD->GetGammaCount();
+                G4double Ngamma = mySD->GetGammaCount();
                 G4double EeSum = mySD->GetElectronEnergySum();
-                G4int Ne = mySD->GetElectronCount();
+                G4double Ne = mySD->GetElectronCount();
 
                 // These vectors are automatically passed by const reference due to the function signature
-                std::vector<int> particleCounts = {Ntot, Ngamma, Ne};
+                std::vector<G4double> particleCounts = {Ntot, Ngamma, Ne};
                 std::vector<G4double> energySums = {energySum, EgammaSum, EeSum};
 
                 fAnaConfigManager.FillBaseNtuple_summary(mySD->GetTupleID(), particleCounts, energySums);
@@ -117,9 +125,54 @@ void RunAction::EndOfRunAction(const G4Run* run) {
     }
 
 
+    // stats mode: one row of moments per summary column
+    if (fOutputMode == "stats") {
+        fAnaConfigManager.WriteStats();
+    }
+
     // show Rndm status
     //CLHEP::HepRandom::showEngineStatus();
+
+    // voxelised shower development summed over the run
+    if (fAnaConfigManager.GetShowerDevStat() == 2 && fAnaConfigManager.GetShowerWrite() == "run") {
+        fAnaConfigManager.WriteShowerGrid(-1);
+    }
+
+    // number of aborted events per reason
+    if (fAnaConfigManager.GetAbortStatus()) {
+        fAnaConfigManager.EndOfRunAbort();
+    }
+
+    // trigger efficiency of the run
+    if (fAnaConfigManager.GetTriggerStatus()) {
+        fAnaConfigManager.EndOfRunTrigger();
+    }
+
+    // sparse summary: number of skipped empty events per detector
+    if (fAnaConfigManager.GetSparseStatus()) {
+        fAnaConfigManager.EndOfRunSparse(NbOfEvents);
+    }
+
+    // online asymmetry estimate and why the run stopped
+    if (fAnaConfigManager.GetAsymEstimate()) {
+        fAnaConfigManager.EndOfRunAsymmetry(NbOfEvents);
+    }
     
+    // response runs: add this energy and polarization sign to the response matrix file
+    if (fAnaConfigManager.GetResponseStatus()) {
+        fAnaConfigManager.EndOfRunResponse();
+    }
+
+    // biased runs: variance and figure of merit of the calorimeter sums
+    if (fAnaConfigManager.GetFomStatus()) {
+        fAnaConfigManager.EndOfRunFigureOfMerit();
+    }
+
+    // stacking policy: peak stack depth and killed tracks of the run
+    if (fAnaConfigManager.GetStackingStatus()) {
+        fAnaConfigManager.EndOfRunStacking();
+    }
+
     //save the config data in a ttree. Has to be last ntuple to be created! 
     fAnaConfigManager.SetupMetadataTTree();
 
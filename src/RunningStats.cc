@@ -0,0 +1,61 @@
+#include "RunningStats.hh"
+
+#include <algorithm>
+#include <cmath>
+
+RunningStats::RunningStats(std::size_t nColumns)
+    : fMean(nColumns),
+      fM2(nColumns),
+      fM3(nColumns),
+      fCoMoment(nColumns*nColumns),
+      fDelta(nColumns) {}
+
+RunningStats::~RunningStats() {}
+
+void RunningStats::Reset() {
+    fN = 0;
+    std::fill(fMean.begin(), fMean.end(), 0.0);
+    std::fill(fM2.begin(), fM2.end(), 0.0);
+    std::fill(fM3.begin(), fM3.end(), 0.0);
+    std::fill(fCoMoment.begin(), fCoMoment.end(), 0.0);
+}
+
+void RunningStats::Add(const std::vector<double>& row) {
+    const std::size_t n = fMean.size();
+    const double n1 = fN;
+    fN += 1;
+    const double nNew = fN;
+
+    // third and second moment need the old M2, so M3 is updated first
+    for (std::size_t i = 0; i < n; ++i) {
+        double delta = row[i] - fMean[i];
+        double deltaN = delta/nNew;
+        double term = delta*deltaN*n1;
+        fDelta[i] = delta;
+        fMean[i] += deltaN;
+        fM3[i] += term*deltaN*(nNew-2) - 3*deltaN*fM2[i];
+        fM2[i] += term;
+    }
+
+    // co-moment: (x_i - old mean_i)*(x_j - new mean_j)
+    for (std::size_t i = 0; i < n; ++i) {
+        const double di = fDelta[i];
+        double* cRow = &fCoMoment[i*n];
+        for (std::size_t j = 0; j < n; ++j) {
+            cRow[j] += di*(row[j] - fMean[j]);
+        }
+    }
+}
+
+double RunningStats::GetVariance(std::size_t i) const {
+    return fN > 1 ? fM2[i]/(fN-1) : 0.0;
+}
+
+double RunningStats::GetSkewness(std::size_t i) const {
+    if (fN < 2 || fM2[i] <= 0) return 0.0;
+    return std::sqrt(double(fN))*fM3[i]/std::pow(fM2[i], 1.5);
+}
+
+double RunningStats::GetCovariance(std::size_t i, std::size_t j) const {
+    return fN > 1 ? fCoMoment[i*fMean.size()+j]/(fN-1) : 0.0;
+}
@@ -0,0 +1,68 @@
+// ScoringParallelWorld.cc
+#include "ScoringParallelWorld.hh"
+#include "BaseSensitiveDetector.hh"
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4RotationMatrix.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4SDManager.hh"
+
+ScoringParallelWorld::ScoringParallelWorld(const ConfigReader& config, AnaConfigManager& anaConfigManager)
+  : G4VUserParallelWorld(GetWorldName()),
+    fAnaConfigManager(anaConfigManager),
+    fPlanes(config.ReadScoringPlanes()) {
+}
+
+ScoringParallelWorld::~ScoringParallelWorld() {}
+
+const G4String& ScoringParallelWorld::GetWorldName() {
+    static const G4String name = "ScoringWorld";
+    return name;
+}
+
+void ScoringParallelWorld::Construct() {
+    // the parallel world volume is a copy of the mass world, materials are ignored here
+    G4LogicalVolume* logicWorld = GetWorld()->GetLogicalVolume();
+
+    // the planes only need a finite thickness for the navigation
+    G4double planeThick = 1.0*um;
+
+    fLogicPlanes.clear();
+    fNormals.clear();
+    for (const auto& plane : fPlanes) {
+        auto solidPlane = new G4Box("solid" + plane.name, plane.sizeX/2.*mm, plane.sizeY/2.*mm, planeThick/2.);
+        auto logicPlane = new G4LogicalVolume(solidPlane, nullptr, "logic" + plane.name);
+
+        // same order of the rotations as for the placement of the solenoid and the calorimeter
+        G4RotationMatrix* planeRotation = new G4RotationMatrix();
+        planeRotation->rotateY(plane.yRot*deg);
+        planeRotation->rotateX(plane.xRot*deg);
+        new G4PVPlacement(planeRotation,
+                          G4ThreeVector(0., 0., plane.z*mm),
+                          logicPlane,
+                          "phys" + plane.name,
+                          logicWorld,
+                          false,
+                          0);
+
+        fLogicPlanes.push_back(logicPlane);
+        fNormals.push_back(planeRotation->inverse()*G4ThreeVector(0., 0., 1.));
+    }
+}
+
+void ScoringParallelWorld::ConstructSD() {
+    auto& mapping = fAnaConfigManager.GetNtupleNameToIdMap();
+    for (std::size_t i = 0; i < fPlanes.size(); ++i) {
+        auto it = mapping.find(fPlanes[i].name);
+        if (it == mapping.end()) {
+            G4cout << "Ntuple name not found in map: " << fPlanes[i].name << G4endl;
+            continue;
+        }
+        // hits are recorded when a particle crosses the plane
+        auto sdPlane = new BaseSensitiveDetector(fPlanes[i].name, fPlanes[i].name, it->second, fAnaConfigManager, true, fNormals[i]);
+        G4SDManager::GetSDMpointer()->AddNewDetector(sdPlane);
+        SetSensitiveDetector(fLogicPlanes[i], sdPlane);
+    }
+}
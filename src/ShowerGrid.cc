@@ -0,0 +1,51 @@
+#include "ShowerGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+
+ShowerGrid::ShowerGrid() {}
+
+ShowerGrid::~ShowerGrid() {}
+
+void ShowerGrid::Configure(int nCells, int nx, int ny, int nz, double halfXY, double halfZ) {
+    fNCells = std::max(nCells, 1);
+    fNx = std::max(nx, 1);
+    fNy = std::max(ny, 1);
+    fNz = std::max(nz, 1);
+    fHalfXY = halfXY;
+    fHalfZ = halfZ;
+    fEdep.assign(std::size_t(fNCells)*fNx*fNy*fNz, 0.0);
+    fFilled.clear();
+}
+
+void ShowerGrid::Reset() {
+    for (auto index : fFilled) {
+        fEdep[index] = 0.0;
+    }
+    fFilled.clear();
+}
+
+int ShowerGrid::Bin(double value, double half, int n) const {
+    // points on the surface of the crystal go into the outermost bins
+    int bin = int(std::floor((value + half)/(2*half)*n));
+    return std::min(std::max(bin, 0), n-1);
+}
+
+void ShowerGrid::Add(int cell, double x, double y, double z, double edep) {
+    if (edep == 0 || cell < 0 || cell >= fNCells) return;
+    std::size_t index = ((std::size_t(cell)*fNx + Bin(x, fHalfXY, fNx))*fNy
+                         + Bin(y, fHalfXY, fNy))*fNz + Bin(z, fHalfZ, fNz);
+    if (fEdep[index] == 0) {
+        fFilled.push_back(index);
+    }
+    fEdep[index] += edep;
+}
+
+void ShowerGrid::GetBin(std::size_t index, int& cell, int& ix, int& iy, int& iz) const {
+    iz = index % fNz;
+    index /= fNz;
+    iy = index % fNy;
+    index /= fNy;
+    ix = index % fNx;
+    cell = index / fNx;
+}
@@ -18,6 +18,8 @@
 #include "G4RunManager.hh"
 #include "G4PolarizationManager.hh"
 #include "G4SDManager.hh"
+#include "ComptonBiasingOperator.hh"
+#include "G4BOptrForceCollision.hh"
 
 #include "G4UniformMagField.hh"
 #include "G4FieldManager.hh"
@@ -49,6 +51,9 @@ Solenoid::Solenoid(const ConfigReader& config, AnaConfigManager& anaConfigManage
     fPolDeg = config.GetConfigValueAsDouble("Solenoid","polDeg");
 
     fBz = config.GetConfigValueAsDouble("Solenoid","Bz");
+    fDetailLevel = config.ReadDetailLevel();
+    fLogicVacStep1 = nullptr;
+    fLogicVacStep2 = nullptr;
     
 }
 
@@ -123,17 +128,29 @@ G4LogicalVolume* Solenoid::ConstructSolenoid() {
     //---------------------------------------------------------------
     // housing of the solenoid
     //---------------------------------------------------------------
-    G4double DzArrayMagnet   [] = {-fMagThick/2., -coneDist, -fCoreLength/2., fCoreLength/2.,  coneDist, fMagThick/2.};
-    G4double RminArrayMagnet [] = {rOpen,  fCoreRad,  fCoreRad, fCoreRad,  fCoreRad,  rOpen};
-    G4double RmaxArrayMagnet [] = {rMax, rMax, rMax, rMax, rMax, rMax};
-    
-    G4Polycone* solidMagnet = new G4Polycone("solidMagnet", 	 //its name
-              0.0*deg, 		 //its start angle
-              360.0*deg,		 //its opening angle
-              6, 		         //its nZ
-              DzArrayMagnet, 	 //z value
-              RminArrayMagnet, 	 //rmin
-              RmaxArrayMagnet ); 	 //rmax
+    G4VSolid* solidMagnet;
+    if (fDetailLevel == "minimal"){
+      // simple tube around the core, the conical openings towards the ends are filled with iron
+      solidMagnet = new G4Tubs("solidMagnet", // name
+                               fCoreRad, // inner radius
+                               rMax, // outer radius
+                               fMagThick/2., // half length in z
+                               0.0*deg, // starting angle
+                               360.0*deg ); // total angle
+    }
+    else{
+      G4double DzArrayMagnet   [] = {-fMagThick/2., -coneDist, -fCoreLength/2., fCoreLength/2.,  coneDist, fMagThick/2.};
+      G4double RminArrayMagnet [] = {rOpen,  fCoreRad,  fCoreRad, fCoreRad,  fCoreRad,  rOpen};
+      G4double RmaxArrayMagnet [] = {rMax, rMax, rMax, rMax, rMax, rMax};
+
+      solidMagnet = new G4Polycone("solidMagnet", 	 //its name
+                0.0*deg, 		 //its start angle
+                360.0*deg,		 //its opening angle
+                6, 		         //its nZ
+                DzArrayMagnet, 	 //z value
+                RminArrayMagnet, 	 //rmin
+                RmaxArrayMagnet ); 	 //rmax
+    }
 
     G4LogicalVolume* logicMagnet = new G4LogicalVolume(solidMagnet, //its solid
                      iron, 	 //its material
@@ -285,31 +302,36 @@ G4LogicalVolume* Solenoid::ConstructSolenoid() {
                                 0.0*deg,    // starting phi angle
                                 360.0*deg); // angle of the segment
 
+    // below the full detail level the virtual detectors are only built if they are read out
     // the first one after converter in front of iron core 
-    fLogicVacStep1 = new G4LogicalVolume(solidVacStep,    //its solid
-                                           Materials::GetInstance()->GetMaterial(fWorldMaterial),    //its material
-                                           "logicVacStep1");  //its name
-
-    new G4PVPlacement(0,                 //no rotation
-                         G4ThreeVector(0.,0., - fCoreLength/2 -coreGap +vacThick/2 +1.0*mm),    //its position
-                                 fLogicVacStep1,            //its logical volume
-                                 "physVacStep1",                 //its name
-                                 logicSolenoid,               //its mother
-                                 false,                     //no boolean operat
-                                 0);                        //copy number
+    if (fDetailLevel == "full" || fConfig.GetConfigValueAsInt("Solenoid","inFrontCore")){
+      fLogicVacStep1 = new G4LogicalVolume(solidVacStep,    //its solid
+                                             Materials::GetInstance()->GetMaterial(fWorldMaterial),    //its material
+                                             "logicVacStep1");  //its name
+
+      new G4PVPlacement(0,                 //no rotation
+                           G4ThreeVector(0.,0., - fCoreLength/2 -coreGap +vacThick/2 +1.0*mm),    //its position
+                                   fLogicVacStep1,            //its logical volume
+                                   "physVacStep1",                 //its name
+                                   logicSolenoid,               //its mother
+                                   false,                     //no boolean operat
+                                   0);                        //copy number
+    }
 
     // the second behind iron core 
-    fLogicVacStep2 = new G4LogicalVolume(solidVacStep,    //its solid
-                                           Materials::GetInstance()->GetMaterial(fWorldMaterial),    //its material
-                                           "logicVacStep2");  //its name
-
-    new G4PVPlacement(0,                 //no rotation
-                      G4ThreeVector(0.,0.,fCoreLength/2 + vacThick/2 + 10.0*mm),    //its position
-                      fLogicVacStep2,            //its logical volume
-                      "physVacStep1",                 //its name
-                      logicSolenoid,               //its mother
-                      false,                     //no boolean operat
-                      0);                        //copy number
+    if (fDetailLevel == "full" || fConfig.GetConfigValueAsInt("Solenoid","behindCore")){
+      fLogicVacStep2 = new G4LogicalVolume(solidVacStep,    //its solid
+                                             Materials::GetInstance()->GetMaterial(fWorldMaterial),    //its material
+                                             "logicVacStep2");  //its name
+
+      new G4PVPlacement(0,                 //no rotation
+                        G4ThreeVector(0.,0.,fCoreLength/2 + vacThick/2 + 10.0*mm),    //its position
+                        fLogicVacStep2,            //its logical volume
+                        "physVacStep1",                 //its name
+                        logicSolenoid,               //its mother
+                        false,                     //no boolean operat
+                        0);                        //copy number
+    }
 
     if((fBeamLineStatus==1) || (fLanexStatus!=0)){
       G4Tubs* solidLanex = new G4Tubs("solidLanex", // name of the solid 
@@ -340,7 +362,8 @@ G4LogicalVolume* Solenoid::ConstructSolenoid() {
                         1); // copy number 
     }
 
-    if((fBeamLineStatus==1) || (fTableStatus!=0)){
+    // the table is far off the beam axis and is dropped at the minimal detail level
+    if(((fBeamLineStatus==1) || (fTableStatus!=0)) && fDetailLevel != "minimal"){
       auto solidTable = new G4Box("solidTable",  //Name
                                 tableX/2.,   // half size in x 
                                 tableY/2,     // half size in y size
@@ -423,6 +446,24 @@ void Solenoid::ConstructSolenoidBfield(){
 
 }
 
+void Solenoid::ConstructSolenoidBiasing(){
+  // the operators belong to the biasing operator store, as in the Geant4 biasing examples
+  G4String coreBiasing = fConfig.ReadCoreBiasing();
+  if (coreBiasing == "scale"){
+    G4double xsScale = 10.;
+    if (!fConfig.GetConfigValue("Biasing", "xsScale").empty()){
+      xsScale = fConfig.GetConfigValueAsDouble("Biasing", "xsScale");
+    }
+    auto* scaleOperator = new ComptonBiasingOperator(xsScale);
+    scaleOperator->AttachTo(fLogicCore);
+    G4cout << "Compton cross section in the core scaled by " << xsScale << G4endl;
+  } else if (coreBiasing == "force"){
+    auto* forceOperator = new G4BOptrForceCollision("gamma", "forceCollisionCore");
+    forceOperator->AttachTo(fLogicCore);
+    G4cout << "Gamma interaction forced in the core" << G4endl;
+  }
+}
+
 void Solenoid::SetBz(G4double newBz) {
     fBz = newBz;
     ConstructSolenoidBfield();
@@ -0,0 +1,97 @@
+// StackingAction.cc
+#include "StackingAction.hh"
+#include "AnaConfigManager.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4PrimaryTransformer.hh"
+#include "G4StackManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+
+StackingAction::StackingAction(const ConfigReader& config, AnaConfigManager& anaConfigManager,
+                               leap::GpsPrimaryGeneratorAction* generator)
+    : G4UserStackingAction(),
+      fAnaConfigManager(anaConfigManager),
+      fStackingStatus(anaConfigManager.GetStackingStatus()),
+      fStackClasses(anaConfigManager.GetStackClasses()),
+      fGenerator(generator),
+      fTransformer(new G4PrimaryTransformer()) {
+
+    fLowEnergy = 1.*MeV;
+    if (!config.GetConfigValue("Stacking", "lowEnergy").empty()) {
+        fLowEnergy = config.GetConfigValueAsDouble("Stacking", "lowEnergy")*MeV;
+    }
+    fOpticalPhoton = G4OpticalPhoton::Definition();
+    for (const auto& stackClass : fStackClasses) {
+        if (stackClass.policy == "kill") {
+            fClassifications.push_back(fKill);
+        } else if (stackClass.policy == "defer") {
+            fClassifications.push_back(fWaiting);
+        } else {
+            fClassifications.push_back(fUrgent);
+        }
+        if (fStackingStatus) {
+            G4cout << "----> Stack class " << stackClass.name << ": " << stackClass.policy << ", cap " << stackClass.cap << G4endl;
+        }
+    }
+}
+
+StackingAction::~StackingAction() {
+    delete fStreamEvent;
+    delete fTransformer;
+}
+
+int StackingAction::GetStackClass(const G4Track* track) const {
+    // same order as ConfigReader::ReadStackClasses
+    if (track->GetDefinition() == fOpticalPhoton) return 0;
+    return track->GetKineticEnergy() < fLowEnergy ? 1 : 2;
+}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track) {
+    if (!fStackingStatus) return fUrgent;
+
+    int stackClass = GetStackClass(track);
+    G4ClassificationOfNewTrack classification = fClassifications[stackClass];
+    // primaries are always tracked, the policy is for the secondaries
+    if (track->GetParentID() == 0 && classification == fKill) {
+        classification = fUrgent;
+    }
+    if (classification != fKill && track->GetParentID() > 0 && fStackClasses[stackClass].cap > 0) {
+        long depth = classification == fWaiting ? stackManager->GetNWaitingTrack() : stackManager->GetNUrgentTrack();
+        if (depth >= fStackClasses[stackClass].cap) classification = fKill;
+    }
+
+    if (classification == fKill) {
+        fAnaConfigManager.CountKilledTrack(stackClass, track->GetKineticEnergy()*track->GetWeight());
+    } else {
+        fAnaConfigManager.CountStackedTrack(stackClass, stackManager->GetNTotalTrack() + 1);
+    }
+    return classification;
+}
+
+void StackingAction::NewStage() {
+    if (!fGenerator->GetStreamSize()) return;
+
+    // the waiting stack is already moved to the urgent one here, so an empty
+    // urgent stack means that no track of the previous group is left
+    if (stackManager->GetNUrgentTrack() > 0) return;
+
+    const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+    G4Event* streamEvent = new G4Event(event->GetEventID());
+    if (fGenerator->GenerateStreamChunk(streamEvent) == 0) {
+        delete streamEvent;
+        return;
+    }
+    // track IDs are reassigned by the event manager, they continue the ones of the event
+    G4TrackVector* tracks = fTransformer->GimmePrimaries(streamEvent);
+    G4EventManager::GetEventManager()->StackTracks(tracks, false);
+
+    delete fStreamEvent;
+    fStreamEvent = streamEvent;
+}
+
+void StackingAction::PrepareNewEvent() {
+    delete fStreamEvent;
+    fStreamEvent = nullptr;
+}
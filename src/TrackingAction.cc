@@ -0,0 +1,27 @@
+// TrackingAction.cc
+#include "TrackingAction.hh"
+#include "AnaConfigManager.hh"
+#include "G4Track.hh"
+
+TrackingAction::TrackingAction(AnaConfigManager& anaConfigManager)
+    : G4UserTrackingAction(),
+      fAnaConfigManager(anaConfigManager),
+      fTrackHistory(anaConfigManager.GetTrackHistoryStatus()),
+      fCpuBudget(anaConfigManager.GetCpuBudget()) {
+
+    // constructor body
+}
+
+TrackingAction::~TrackingAction() {
+}
+
+void TrackingAction::PreUserTrackingAction(const G4Track* track) {
+    // every track is registered, whether it reaches a detector is only known later
+    if (fTrackHistory) {
+        fAnaConfigManager.RegisterTrack(track);
+    }
+    // the CPU time of the event is checked once per track, which is cheap compared to the tracking
+    if (fCpuBudget > 0) {
+        fAnaConfigManager.CheckCpuBudget();
+    }
+}